@@ -0,0 +1,98 @@
+#include "Channel.h"
+
+#include <stdint.h>
+
+#include "Delegate.h"
+#include "Stats.h"
+#include "ch.h"
+
+cal::ChannelBase::ChannelBase(size_t capacity) : m_capacity(capacity) {
+  // taken, the first commit releases it
+  chBSemObjectInit(&m_notEmpty, true);
+}
+
+size_t cal::ChannelBase::size() const {
+  // tail first, it can only catch up to a head read after it
+  uint32_t tail = m_tail.load(std::memory_order_acquire);
+  return m_head.load(std::memory_order_acquire) - tail;
+}
+
+size_t cal::ChannelBase::capacity() const { return m_capacity; }
+
+/**
+ * @note The semaphore remembers a commit that happens between the size check
+ *       and the wait, so no wakeup is lost
+ */
+bool cal::ChannelBase::wait(systime_t timeout) {
+  while (size() == 0) {
+    if (chBSemWaitTimeout(&m_notEmpty, timeout) != MSG_OK) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t cal::ChannelBase::rejectedPushes() const {
+  return m_rejectedPushes.value();
+}
+
+void cal::ChannelBase::registerStats(const char *group) {
+  cal::Stats::add(group, "depth", [] (void *arg) -> uint32_t {
+    return static_cast<ChannelBase *>(arg)->size();
+  }, this);
+  cal::Stats::add(group, "rejected", m_rejectedPushes);
+}
+
+void cal::ChannelBase::setPushHook(cal::Delegate<void()> hook) {
+  syssts_t sts = chSysGetStatusAndLockX();
+  m_pushHook = hook;
+  chSysRestoreStatusX(sts);
+}
+
+/**
+ * @note Only the producer writes the head, so it's read relaxed. Reading the
+ *       tail with acquire keeps the slot's previous item from being
+ *       overwritten before the consumer is done with it.
+ */
+bool cal::ChannelBase::reserve(uint32_t& index) {
+  uint32_t head = m_head.load(std::memory_order_relaxed);
+  if (head - m_tail.load(std::memory_order_acquire) == m_capacity) {
+    m_rejectedPushes.increment();
+    return false;
+  }
+  index = head;
+  return true;
+}
+
+void cal::ChannelBase::publish() {
+  // the item is written before the consumer can see it
+  m_head.store(m_head.load(std::memory_order_relaxed) + 1,
+      std::memory_order_release);
+  notify();
+}
+
+bool cal::ChannelBase::front(uint32_t& index) const {
+  uint32_t tail = m_tail.load(std::memory_order_relaxed);
+  if (m_head.load(std::memory_order_acquire) == tail) {
+    return false;
+  }
+  index = tail;
+  return true;
+}
+
+void cal::ChannelBase::retire() {
+  // the item is destroyed before the producer can reuse its slot
+  m_tail.store(m_tail.load(std::memory_order_relaxed) + 1,
+      std::memory_order_release);
+}
+
+void cal::ChannelBase::notify() {
+  syssts_t sts = chSysGetStatusAndLockX();
+  chBSemSignalI(&m_notEmpty);
+  cal::Delegate<void()> hook = m_pushHook;
+  chSysRestoreStatusX(sts);
+
+  if (hook) {
+    hook();
+  }
+}
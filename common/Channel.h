@@ -0,0 +1,186 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "Delegate.h"
+#include "Stats.h"
+#include "ch.h"
+
+namespace cal {
+
+/**
+ * @brief Size- and type-independent part of cal::Channel
+ *
+ * Keeps the ring's running write (head) and read (tail) counts, and wakes the
+ * consumer. Producers only advance the head and consumers the tail, so with
+ * a single producer and a single consumer neither side takes a lock.
+ */
+class ChannelBase {
+ public:
+  // instances are referenced by address by both sides
+  ChannelBase(const ChannelBase&) = delete;
+  ChannelBase& operator=(const ChannelBase&) = delete;
+
+  // @return Number of committed items not yet released
+  size_t size() const;
+
+  // @return Max number of items in flight
+  size_t capacity() const;
+
+  /**
+   * @brief Wait (block) until the channel becomes non-empty. Only the
+   *        channel's consumer may wait.
+   * @param timeout System ticks before call times out
+   * @return True if the channel is now non-empty, false if timed out
+   */
+  bool wait(systime_t timeout = TIME_INFINITE);
+
+  // @return Number of pushes that failed because the channel was full
+  uint32_t rejectedPushes() const;
+
+  /**
+   * @brief Register the channel's depth and rejected pushes in cal::Stats
+   * @param group Name the channel's stats are listed under
+   */
+  void registerStats(const char *group);
+
+  /**
+   * @brief Call hook after every commit, for consumers that don't block in
+   *        wait() (e.g. tasks of a cal::TaskScheduler)
+   * @note Called from the producing context, which may be an ISR
+   */
+  void setPushHook(cal::Delegate<void()> hook);
+
+ protected:
+  explicit ChannelBase(size_t capacity);
+
+  /**
+   * @brief Find the slot the producer writes next
+   * @return False if the channel is full (counted as a rejected push)
+   */
+  bool reserve(uint32_t& index);
+
+  // @brief Hand the reserved slot to the consumer, and wake it
+  void publish();
+
+  /**
+   * @brief Find the slot the consumer reads next
+   * @return False if the channel is empty
+   */
+  bool front(uint32_t& index) const;
+
+  // @brief Hand the front slot back to the producer
+  void retire();
+
+ private:
+  // @brief Wake the consumer, callable from any context
+  void notify();
+
+  size_t m_capacity;
+
+  // running counts of committed and released items, they wrap
+  std::atomic<uint32_t> m_head{0};
+  std::atomic<uint32_t> m_tail{0};
+
+  cal::Counter m_rejectedPushes;
+
+  // signaled on every commit, taken by wait()
+  binary_semaphore_t m_notEmpty;
+
+  // called after every commit, e.g. to wake a consumer not blocked in wait()
+  cal::Delegate<void()> m_pushHook;
+};
+
+/**
+ * @brief Bounded single-producer, single-consumer channel of typed items
+ *
+ * An alternative to EventQueue for high-rate data (e.g. CAN frames, ADC
+ * blocks) that doesn't fit an Event's params, or would be copied param by
+ * param. Items are constructed in place in the channel's slots and read in
+ * place, so they're never copied, and may be move-only.
+ *
+ * Producer side: emplace() or push(), or acquire() a slot, fill it in place,
+ * then commit() it. Consumer side: peek() at the oldest item, then release()
+ * it, or pop() it into a variable.
+ *
+ * @code
+ *   AdcBlock *block = channel.acquire();
+ *   if (block != nullptr) {
+ *     adcRead(block->samples);
+ *     channel.commit();
+ *   }
+ *   ...
+ *   channel.wait();
+ *   process(*channel.peek());
+ *   channel.release();
+ * @endcode
+ *
+ * @tparam T Item type, constructed and destroyed in place
+ * @tparam N Number of slots, a power of two (the running counts wrap)
+ *
+ * @note Lock-free, so either side may run in an ISR, but there must be one
+ *       producer and one consumer: use an EventQueue when several modules
+ *       post to one consumer
+ * @note Each side may only have one slot outstanding, acquire() again only
+ *       after commit() and peek() again only after release()
+ */
+template <class T, size_t N>
+class Channel : public ChannelBase {
+ public:
+  static_assert(N > 0 && (N & (N - 1)) == 0,
+      "cal::Channel size must be a power of two");
+
+  Channel();
+  ~Channel();
+
+  /**
+   * @brief Construct an item in the next free slot, for the producer to fill
+   *        before commit()
+   * @return The item, nullptr if the channel is full
+   */
+  template <class... Args>
+  T *acquire(Args&&... args);
+
+  // @brief Hand the item from acquire() to the consumer
+  void commit();
+
+  // @brief Construct an item in place and commit it
+  // @return False if the channel is full
+  template <class... Args>
+  bool emplace(Args&&... args);
+
+  // @return False if the channel is full
+  bool push(const T& item);
+  bool push(T&& item);
+
+  // @return The oldest item, left in the channel until release(), nullptr if
+  //         the channel is empty
+  T *peek();
+
+  // @brief Destroy the item from peek(), freeing its slot
+  void release();
+
+  /**
+   * @brief Move the oldest item into item and release it
+   * @return False if the channel is empty
+   */
+  bool pop(T& item);
+
+ private:
+  T *slot(uint32_t index);
+
+  typename std::aligned_storage<sizeof(T), alignof(T)>::type m_slots[N];
+
+  // slot from acquire() awaiting commit()
+  uint32_t m_acquired = 0;
+};
+
+}
+
+#include "Channel.inc"
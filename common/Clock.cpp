@@ -0,0 +1,66 @@
+#include "Clock.h"
+
+#include "ExtendedCounter.h"
+#include "ch.h"
+#include "hal.h"
+#include "stm32_tim.h"
+
+// Definitions for static members
+constexpr uint32_t cal::Clock::kFrequency;
+constexpr systime_t cal::Clock::kRefreshPeriod;
+cal::ExtendedCounter cal::Clock::counter;
+virtual_timer_t cal::Clock::refreshTimer;
+
+void cal::Clock::start() {
+  rccEnableTIM5(FALSE);
+
+  // free-running up-counter over the full 32 bit range, at the timer clock
+  STM32_TIM5->CR1 = 0;
+  STM32_TIM5->PSC = 0;
+  STM32_TIM5->ARR = 0xFFFFFFFF;
+  STM32_TIM5->CNT = 0;
+  STM32_TIM5->EGR = STM32_TIM_EGR_UG;
+  STM32_TIM5->CR1 = STM32_TIM_CR1_CEN;
+
+  chVTObjectInit(&refreshTimer);
+
+  chSysLock();
+  counter = cal::ExtendedCounter(STM32_TIM5->CNT);
+  chVTSetI(&refreshTimer, kRefreshPeriod, &cal::Clock::refreshCallback,
+      nullptr);
+  chSysUnlock();
+}
+
+/**
+ * @note The counter is read within the lock, so readings reach the extension
+ *       in the order they were taken
+ */
+uint64_t cal::Clock::now() {
+  syssts_t sts = chSysGetStatusAndLockX();
+  uint64_t ticks = counter.extend(STM32_TIM5->CNT);
+  chSysRestoreStatusX(sts);
+
+  return ticks;
+}
+
+uint32_t cal::Clock::now32() { return STM32_TIM5->CNT; }
+
+uint64_t cal::Clock::nowUs() { return toUs(now()); }
+
+uint64_t cal::Clock::toUs(uint64_t ticks) {
+  return ticks / (kFrequency / 1000000);
+}
+
+uint32_t cal::Clock::elapsedUs(uint32_t since) {
+  return static_cast<uint32_t>(toUs(now32() - since));
+}
+
+void cal::Clock::refreshCallback(void *arg) {
+  static_cast<void>(arg);
+
+  chSysLockFromISR();
+  counter.extend(STM32_TIM5->CNT);
+  chVTSetI(&refreshTimer, kRefreshPeriod, &cal::Clock::refreshCallback,
+      nullptr);
+  chSysUnlockFromISR();
+}
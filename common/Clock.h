@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ExtendedCounter.h"
+#include "ch.h"
+#include "hal.h"
+
+namespace cal {
+
+/**
+ * @brief Monotonic high-resolution clock, for timestamps finer than the
+ *        100 us system tick
+ *
+ * Reads a free-running 32 bit hardware timer (TIM5, clocked at the APB1
+ * timer clock) and extends it to 64 bits. Unlike the realtime (DWT cycle)
+ * counter, the timer keeps counting while the core sleeps in WFI, so the
+ * clock stays monotonic and in step with wall time.
+ *
+ * Like cal::KernelProfiler, the state is static and there is a single,
+ * global clock.
+ *
+ * @note now32() is a plain register read, cheap enough to stamp every event
+ *       (see CAL_USE_EVENT_TIMESTAMPS in Event.h). It wraps after
+ *       2^32 / kFrequency (~51 s), so differences of now32() values are only
+ *       meaningful for shorter intervals. now() doesn't wrap.
+ * @note TIM5 must not be used by any driver (e.g. GPT, ICU, PWM)
+ */
+class Clock {
+ public:
+  // Ticks per second
+  static constexpr uint32_t kFrequency = STM32_TIMCLK1;
+
+  /**
+   * @brief Start the hardware timer, all readings are 0 before this is
+   *        called
+   * @note Call after halInit() and chSysInit()
+   */
+  static void start();
+
+  // @return Ticks since start(), callable from any context
+  static uint64_t now();
+
+  // @return Low 32 bits of now(), callable from any context
+  static uint32_t now32();
+
+  // @return Microseconds since start(), callable from any context
+  static uint64_t nowUs();
+
+  // @return Duration of ticks in microseconds
+  static uint64_t toUs(uint64_t ticks);
+
+  // @return Microseconds since a now32() reading, for intervals shorter than
+  //         the wrap period
+  static uint32_t elapsedUs(uint32_t since);
+
+ private:
+  // @brief Reads the counter often enough for it to never wrap unseen
+  static void refreshCallback(void *arg);
+
+  // Period of refreshCallback(), well within the counter's wrap period
+  static constexpr systime_t kRefreshPeriod = S2ST(10);
+
+  static cal::ExtendedCounter counter;
+  static virtual_timer_t refreshTimer;
+};
+
+}
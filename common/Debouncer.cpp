@@ -0,0 +1,43 @@
+#include "Debouncer.h"
+
+cal::Debouncer::Debouncer(uint32_t window, bool initialState)
+    : m_window(window), m_settledState(initialState) {}
+
+void cal::Debouncer::edge(uint32_t now) {
+  m_rawEdges++;
+
+  // the first edge after a quiet period starts a new burst
+  if (!m_pending) {
+    m_pending = true;
+    m_burstStart = now;
+  }
+  m_lastEdge = now;
+}
+
+/**
+ * @note Time differences are computed with unsigned subtraction, so
+ *       timestamps are allowed to wrap
+ */
+bool cal::Debouncer::settle(uint32_t now, bool level, uint32_t& timestamp) {
+  // still chattering (or nothing to settle), wait for another settle call
+  if (!m_pending || now - m_lastEdge < m_window) {
+    return false;
+  }
+
+  m_pending = false;
+
+  // a glitch that returned to the settled state isn't a transition
+  if (level == m_settledState) {
+    return false;
+  }
+
+  m_settledState = level;
+  timestamp = m_burstStart;
+  return true;
+}
+
+bool cal::Debouncer::state() const { return m_settledState; }
+
+uint32_t cal::Debouncer::window() const { return m_window; }
+
+uint32_t cal::Debouncer::rawEdges() const { return m_rawEdges; }
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace cal {
+
+/**
+ * @brief Timestamp-filtered debouncer for a single digital input
+ *
+ * Raw edges are reported with the time they were observed (from an ISR) and
+ * only collapse into a single settled transition once the input has been quiet
+ * for a full debounce window. The settled transition is stamped with the time
+ * of the first raw edge of the burst, so consumers see when the input actually
+ * started to change rather than when the chatter stopped.
+ *
+ * @note This class has no ChibiOS dependencies, all timestamps are in
+ *       caller-defined units (e.g. system ticks), so it can be driven from a
+ *       simulated edge trace in unit tests
+ * @note Not thread-safe, callers must serialize edge() and settle() (e.g. by
+ *       calling both from within the kernel's ISR critical zone)
+ */
+class Debouncer {
+ public:
+  /**
+   * @param window Time the input must stay quiet before an edge is settled
+   * @param initialState Settled state of the input at construction time
+   */
+  Debouncer(uint32_t window, bool initialState);
+
+  /**
+   * @brief Record a raw edge
+   * @param now Time the edge was observed
+   * @note The level is only sampled in settle(), once the input is quiet
+   */
+  void edge(uint32_t now);
+
+  /**
+   * @brief Check whether the input has settled on a new state
+   * @param now Current time, should be at least window after the last edge
+   * @param level Current level of the input
+   * @param timestamp Set to the time of the first raw edge of the burst if a
+   *        settled transition is reported
+   * @return True if exactly one new settled transition occurred
+   */
+  bool settle(uint32_t now, bool level, uint32_t& timestamp);
+
+  // @return Last settled state of the input
+  bool state() const;
+
+  // @return The debounce window
+  uint32_t window() const;
+
+  // @return Number of raw edges recorded since construction
+  uint32_t rawEdges() const;
+
+ private:
+  uint32_t m_window;
+  bool m_settledState;
+
+  // true while a burst of raw edges is waiting to settle
+  bool m_pending = false;
+  uint32_t m_burstStart = 0;
+  uint32_t m_lastEdge = 0;
+
+  uint32_t m_rawEdges = 0;
+};
+
+}
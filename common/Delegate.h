@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cal {
+
+template <typename Signature>
+class Delegate;
+
+/**
+ * @brief Non-allocating callable bound to an object and a member function, a
+ *        free function, or a functor
+ *
+ * Two pointers: the bound object (or function) and a stub that's
+ * instantiated per target, so a call is a single indirect call to a stub the
+ * compiler inlines the target into. Unlike std::function, binding never
+ * allocates, and delegates are trivially copyable, so they can be stored in
+ * static tables and copied from ISRs.
+ *
+ *   auto d = cal::Delegate<void(int)>::bind<Fsm, &Fsm::onValue>(fsm);
+ *   d(42);
+ *
+ * Delegates of void(void*)-style signatures double as C callbacks, e.g. for
+ * virtual timers:
+ *
+ *   chVTSet(&vt, delay, &cal::Delegate<void()>::invoke, &delegate);
+ *
+ * @note Delegates don't own their targets, bound objects and functors must
+ *       outlive them
+ * @note Calling an empty delegate is undefined, check it first if it may be
+ */
+template <typename R, typename... Args>
+class Delegate<R(Args...)> {
+ public:
+  using Function = R (*)(Args...);
+
+  // @brief Empty delegate
+  constexpr Delegate() = default;
+
+  // @brief Delegate calling a free function (implicit, so plain functions
+  //        can be passed where delegates are expected)
+  Delegate(Function function);
+
+  // @return Delegate calling Method on object
+  template <class T, R (T::*Method)(Args...)>
+  static Delegate bind(T& object);
+
+  template <class T, R (T::*Method)(Args...) const>
+  static Delegate bind(const T& object);
+
+  // @return Delegate calling the functor (e.g. a lambda) by reference
+  template <class F>
+  static Delegate bind(F& functor);
+
+  R operator()(Args... args) const;
+
+  // @return True if bound to a target
+  explicit operator bool() const;
+
+  /**
+   * @brief Call the delegate pointed to by delegate, i.e. a C callback taking
+   *        the delegate as its user argument
+   */
+  static R invoke(void *delegate, Args... args);
+
+ private:
+  using Stub = R (*)(const Delegate& self, Args... args);
+
+  template <class T, R (T::*Method)(Args...)>
+  static R methodStub(const Delegate& self, Args... args);
+
+  template <class T, R (T::*Method)(Args...) const>
+  static R constMethodStub(const Delegate& self, Args... args);
+
+  template <class F>
+  static R functorStub(const Delegate& self, Args... args);
+
+  static R functionStub(const Delegate& self, Args... args);
+
+  // the object, or free function, the stub calls
+  union Target {
+    void *object;
+    Function function;
+  };
+
+  Target m_target = {nullptr};
+  Stub m_stub = nullptr;
+};
+
+}
+
+#include "Delegate.inc"
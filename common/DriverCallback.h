@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cal {
+
+/**
+ * @brief A ChibiOS driver configuration extended with the driver wrapper's
+ *        instance, so the driver's static callbacks can find it
+ *
+ * HAL callbacks (UART, SPI, EXT, GPT, ...) only get the driver, but every
+ * driver keeps a pointer to the configuration it was started with. The
+ * wrapper starts the driver with the embedded config, and
+ * cal::DriverCallback recovers the wrapper from the driver's config pointer:
+ * two loads and a call, instead of searching a driver-to-instance table.
+ *
+ *   cal::DriverConfig<UARTConfig, cal::Uart> m_config{this};
+ *   m_config.config = {&cal::DriverCallback<decltype(&cal::Uart::txEmpty),
+ *       &cal::Uart::txEmpty>::callback, ...};
+ *   uartStart(&UARTD3, &m_config.config);
+ *
+ * @tparam Config The driver's configuration struct (e.g. UARTConfig)
+ * @tparam T The wrapper class the callbacks dispatch to
+ *
+ * @note ADC callbacks belong to the conversion group (adcp->grpp) rather than
+ *       the driver's config, extend the ADCConversionGroup in the same way and
+ *       call instanceOf(adcp->grpp) from a static callback
+ * @note Virtual timers already take a user argument, pass the instance (or a
+ *       cal::Delegate, see Delegate::invoke()) instead
+ */
+template <class Config, class T>
+struct DriverConfig {
+  explicit DriverConfig(T *instance);
+
+  // @return The instance of a driver started with an embedded config
+  static T *instanceOf(const Config *config);
+
+  // must stay first, drivers only know about this member
+  Config config;
+
+  T *const instance;
+};
+
+template <class Method, Method M>
+struct DriverCallback;
+
+/**
+ * @brief C callback dispatching to a member function of the instance whose
+ *        cal::DriverConfig a driver was started with
+ *
+ * The member function takes the same arguments as the HAL callback, e.g.
+ * void txEmpty(UARTDriver *uartp) or void edge(EXTDriver *extp,
+ * expchannel_t channel), and &callback is what goes in the driver config.
+ */
+template <class T, class Driver, class... Args,
+    void (T::*M)(Driver *, Args...)>
+struct DriverCallback<void (T::*)(Driver *, Args...), M> {
+  static void callback(Driver *driverp, Args... args);
+};
+
+}
+
+#include "DriverCallback.inc"
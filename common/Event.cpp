@@ -3,6 +3,10 @@
 #include <array>
 
 #include "Gpio.h"
+#include "PayloadPool.h"
+#if CAL_USE_EVENT_TIMESTAMPS
+#include "Clock.h"
+#endif
 
 Event::Event() {}
 
@@ -10,6 +14,7 @@ Event::Event() {}
 Event::Event(Type t, Gpio adcPin, uint32_t adcValue) : m_type(t) {
   m_params[0] = static_cast<uint32_t>(adcPin);
   m_params[1] = adcValue;
+  stamp();
 }
 Event::Event(Type t, uint32_t canEid, std::array<uint16_t, 8> canFrame)
     : m_type(t) {
@@ -17,18 +22,84 @@ Event::Event(Type t, uint32_t canEid, std::array<uint16_t, 8> canFrame)
 
   // set data frame (max 8 bytes)
   std::copy(canFrame.begin(), canFrame.begin() + 8, m_params.begin() + 1);
+  stamp();
 }
 Event::Event(Type t, DigitalInput pin, bool currentState) : m_type(t) {
   m_params[0] = static_cast<uint16_t>(pin);
   m_params[1] = static_cast<uint16_t>(currentState);
+  stamp();
+}
+Event::Event(Type t, DigitalInput pin, bool currentState, uint32_t timestamp)
+    : Event(t, pin, currentState) {
+  // split the timestamp across two params
+  m_params[2] = static_cast<uint16_t>(timestamp & 0xFFFF);
+  m_params[3] = static_cast<uint16_t>(timestamp >> 16);
 }
 
 Event::Event(Type t, char byte) : m_type(t) {
   m_params[0] = static_cast<char>(byte);
+  stamp();
+}
+
+Event::Event(Type t, uint32_t timerId, uint16_t overruns) : m_type(t) {
+  // split the ID across two params
+  m_params[0] = static_cast<uint16_t>(timerId & 0xFFFF);
+  m_params[1] = static_cast<uint16_t>(timerId >> 16);
+  m_params[2] = overruns;
+  stamp();
+}
+
+Event::Event(Type t, cal::Payload *payload) : m_type(t), m_payload(payload) {
+  stamp();
 }
 
 Event::Type Event::type() { return m_type; }
 
+constexpr size_t Event::kTagParam;
+
+void Event::setTag(uint16_t tag) { m_params[kTagParam] = tag; }
+
+uint16_t Event::tag() { return m_params[kTagParam]; }
+
+void Event::stamp() {
+#if CAL_USE_EVENT_TIMESTAMPS
+  m_timestamp = cal::Clock::now32();
+#endif
+}
+
+uint32_t Event::timestamp() {
+#if CAL_USE_EVENT_TIMESTAMPS
+  return m_timestamp;
+#else
+  return 0;
+#endif
+}
+
+constexpr size_t Event::kSerializedSize;
+
+void Event::serialize(uint8_t *buf) {
+  buf[0] = static_cast<uint8_t>(m_type);
+  for (size_t i = 0; i < m_params.size(); i++) {
+    buf[1 + 2*i] = static_cast<uint8_t>(m_params[i] & 0xFF);
+    buf[2 + 2*i] = static_cast<uint8_t>(m_params[i] >> 8);
+  }
+}
+
+/**
+ * @note Unknown types are mapped to kNone so a corrupt stream can't produce
+ *       out-of-range types that index per-type tables
+ * @note Timestamps aren't serialized, deserialized events are unstamped
+ */
+Event Event::deserialize(const uint8_t *buf) {
+  Event e;
+  e.m_type = buf[0] < kNumTypes ? static_cast<Type>(buf[0]) : kNone;
+  for (size_t i = 0; i < e.m_params.size(); i++) {
+    e.m_params[i] = static_cast<uint16_t>(buf[1 + 2*i])
+        | static_cast<uint16_t>(buf[2 + 2*i] << 8);
+  }
+  return e;
+}
+
 /**
  * @note Due to a terrible, terrible machine, for which there's no
  *       time to upgrade the toolchain, the toolchain for
@@ -60,6 +131,34 @@ DigitalInput Event::digInPin() {
 
 bool Event::digInState() { return static_cast<bool>(m_params[1]); }
 
+uint32_t Event::digInTime() {
+  return static_cast<uint32_t>(m_params[2])
+      | (static_cast<uint32_t>(m_params[3]) << 16);
+}
+
 char Event::getByte() {
   return static_cast<char>(m_params[0]);
 }
+
+// Timer event member functions
+uint32_t Event::timerId() {
+  return static_cast<uint32_t>(m_params[0])
+      | (static_cast<uint32_t>(m_params[1]) << 16);
+}
+
+uint16_t Event::timerOverruns() { return m_params[2]; }
+
+cal::Payload *Event::payload() { return m_payload; }
+
+void Event::retainPayload() {
+  if (m_payload != nullptr) {
+    m_payload->retain();
+  }
+}
+
+void Event::releasePayload() {
+  if (m_payload != nullptr) {
+    m_payload->release();
+    m_payload = nullptr;
+  }
+}
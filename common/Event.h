@@ -1,26 +1,73 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include <array>
 #include <vector>
 
 #include "Gpio.h"
 
+namespace cal {
+class Payload;
+}
+
+/**
+ * @brief Set to 1 to stamp every event with the cal::Clock time it was
+ *        produced at (e.g. via UDEFS in the application's Makefile)
+ * @note Adds 4 bytes to every event, and a timer read to every constructor
+ */
+#if !defined(CAL_USE_EVENT_TIMESTAMPS)
+#define CAL_USE_EVENT_TIMESTAMPS 0
+#endif
+
 class Event {
  public:
   // Event types
+  // @note kNumTypes must stay last, it sizes per-type lookup tables
   enum Type { kNone, kCanRx, kTimerTimeout, kAdcConversion,
-    kDigInTransition, kUartRx };
+    kDigInTransition, kUartRx, kNumTypes };
 
   Event(Type t, Gpio adcPin, uint32_t adcValue);
   Event(Type t, uint32_t canEid, std::array<uint16_t, 8> canFrame);
   Event(Type t, DigitalInput pin, bool currentState);
+  Event(Type t, DigitalInput pin, bool currentState, uint32_t timestamp);
   Event(Type t, char byte);
+  Event(Type t, uint32_t timerId, uint16_t overruns);
+  Event(Type t, cal::Payload *payload);
   Event();
 
+  // Size of an event's binary representation, its type followed by its
+  // little-endian params
+  static constexpr size_t kSerializedSize = 21;
+
+  // @brief Write the event's binary representation to buf, which must hold
+  //        at least kSerializedSize bytes
+  void serialize(uint8_t *buf);
+
+  // @brief Reconstruct an event from its binary representation
+  // @note Payloads aren't serialized, deserialized events carry none
+  static Event deserialize(const uint8_t *buf);
+
   Type type();
 
+  // @brief Tag the event, e.g. with a sequence number to match it with the
+  //        response it causes. Not used by any type-specific params.
+  void setTag(uint16_t tag);
+  uint16_t tag();
+
+  /**
+   * @brief Stamp the event with the current time, events are stamped when
+   *        they're constructed from params. Re-stamp events constructed
+   *        ahead of time (e.g. deserialized ones) when actually producing them.
+   * @note No-op unless CAL_USE_EVENT_TIMESTAMPS
+   */
+  void stamp();
+
+  // @return Low 32 bits of the cal::Clock time the event was stamped at,
+  //         0 if it wasn't (or unless CAL_USE_EVENT_TIMESTAMPS)
+  uint32_t timestamp();
+
   // type-specific member functions (see note in source)
   Gpio adcPin();
   uint32_t adcValue();
@@ -28,7 +75,28 @@ class Event {
   std::array<uint16_t, 8> canFrame();
   DigitalInput digInPin();
   bool digInState();
+  uint32_t digInTime();
   char getByte();
+  uint32_t timerId();
+  uint16_t timerOverruns();
+
+  /**
+   * @brief Block of bytes carried by the event, for any type (e.g. a whole
+   *        UART frame as a kUartRx event)
+   * @return The payload, nullptr if the event carries none
+   * @note Each queued copy of an event owns one of the payload's references,
+   *       see cal::Payload. Consumers that pop events release them with
+   *       releasePayload() (cal::ActiveObject does it after handle()).
+   */
+  cal::Payload *payload();
+
+  // @brief Add a reference for another copy of the event, e.g. before
+  //        forwarding it from a handler. No-op without a payload.
+  void retainPayload();
+
+  // @brief Drop this copy's reference and detach the payload. No-op without
+  //        a payload.
+  void releasePayload();
 
  private:
   Type m_type = kNone;
@@ -39,4 +107,13 @@ class Event {
    *       the kernel. Be careful with static thread workspace
    */
   std::array<uint16_t, 10> m_params;
+
+#if CAL_USE_EVENT_TIMESTAMPS
+  uint32_t m_timestamp = 0;
+#endif
+
+  cal::Payload *m_payload = nullptr;
+
+  // param holding the tag, after the largest type-specific params (CAN)
+  static constexpr size_t kTagParam = 9;
 };
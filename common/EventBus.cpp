@@ -0,0 +1,67 @@
+#include "EventBus.h"
+
+#include "Event.h"
+#include "EventQueue.h"
+#include "PayloadPool.h"
+
+constexpr size_t cal::EventBus::kMaxSubscribers;
+
+bool cal::EventBus::subscribe(Event::Type type, EventQueue& queue) {
+  return add(type, &queue);
+}
+
+size_t cal::EventBus::publish(Event e) const {
+  Event::Type type = e.type();
+  if (!shareOrDrop(e, m_counts[type])) {
+    return 0;
+  }
+
+  size_t delivered = 0;
+  for (size_t i = 0; i < m_counts[type]; i++) {
+    cal::PushStatus status = m_subscribers[type][i]->push(e);
+    if (status == cal::PushStatus::kOk
+        || status == cal::PushStatus::kDroppedOldest) {
+      delivered++;
+    } else if (status != cal::PushStatus::kDroppedNewest
+        && e.payload() != nullptr) {
+      // rejected or timed out, the subscriber's reference goes unused
+      e.payload()->release();
+    }
+  }
+
+  return delivered;
+}
+
+size_t cal::EventBus::tryPublish(Event e) const {
+  Event::Type type = e.type();
+  size_t delivered = 0;
+  if (!shareOrDrop(e, m_counts[type])) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < m_counts[type]; i++) {
+    if (m_subscribers[type][i]->tryPush(e)) {
+      delivered++;
+    } else if (e.payload() != nullptr) {
+      // the subscriber's reference goes unused
+      e.payload()->release();
+    }
+  }
+
+  return delivered;
+}
+
+/**
+ * @note References are added before the first push, a subscriber may release
+ *       its copy before the event is pushed to the next one
+ */
+bool cal::EventBus::shareOrDrop(Event& e, size_t subscribers) {
+  if (subscribers == 0) {
+    e.releasePayload();
+    return false;
+  }
+  if (e.payload() != nullptr && subscribers > 1) {
+    e.payload()->retain(subscribers - 1);
+  }
+  return true;
+}
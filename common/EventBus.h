@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Event.h"
+#include "EventQueue.h"
+
+namespace cal {
+
+/**
+ * @brief Publish/subscribe fan-out of events to every queue subscribed to
+ *        the event's type
+ *
+ * Producers publish to the bus instead of being wired to exactly one consumer
+ * queue. The subscriber table is a fixed 2D array indexed by Event::Type, so a
+ * publish is a table lookup followed by one enqueue per subscriber, with no
+ * allocation.
+ *
+ * The table can either be filled at runtime with subscribe(), or built at
+ * compile time from a constant subscription list when the subscribed queues
+ * have static storage duration:
+ *
+ *   static cal::MutexEventQueue fsmQueue;
+ *   static cal::MutexEventQueue logQueue;
+ *   static constexpr cal::EventBus::Subscription kSubscriptions[] = {
+ *     {Event::Type::kUartRx, &fsmQueue},
+ *     {Event::Type::kUartRx, &logQueue},
+ *   };
+ *   static constexpr cal::EventBus bus(kSubscriptions);
+ *
+ * @note Events are copied into each subscriber's queue. Every Event is a
+ *       fixed-size value, so that copy is the enqueue itself. Larger messages
+ *       travel as a cal::Payload, of which each subscriber gets a reference.
+ */
+class EventBus {
+ public:
+  // Max number of queues subscribed to a single event type
+  static constexpr size_t kMaxSubscribers = 4;
+
+  struct Subscription {
+    Event::Type type;
+    EventQueue *queue;
+  };
+
+  constexpr EventBus() : m_subscribers(), m_counts() {}
+
+  /**
+   * @brief Build the subscriber table from a constant subscription list
+   * @note Exceeding kMaxSubscribers for one type fails to compile when
+   *       the bus is constexpr, and drops the excess subscriptions otherwise
+   */
+  template <size_t N>
+  constexpr explicit EventBus(const Subscription (&table)[N])
+      : m_subscribers(), m_counts() {
+    for (size_t i = 0; i < N; i++) {
+      if (!add(table[i].type, table[i].queue)) {
+        tooManySubscribers();
+      }
+    }
+  }
+
+  /**
+   * @brief Subscribe a queue to every event of the given type
+   * @return False if the type already has kMaxSubscribers subscribers
+   * @note Not thread-safe, subscribe everything during initialization
+   *       before anything is published
+   */
+  bool subscribe(Event::Type type, EventQueue& queue);
+
+  /**
+   * @brief Thread-safe publish of an event to all of its type's subscribers
+   * @return Number of subscribers the event was queued for, less those
+   *         whose full queue dropped, rejected or timed out on it per its
+   *         overflow policy
+   * @note Publishing takes over the caller's payload reference (if any),
+   *       each subscriber's queue gets one of its own. With no subscribers
+   *       the payload is released.
+   */
+  size_t publish(Event e) const;
+
+  /**
+   * @brief Non-blocking publish for use from driver callbacks
+   * @return Number of subscribers the event was successfully pushed to,
+   *         subscribers whose queue couldn't be immediately acquired miss it
+   */
+  size_t tryPublish(Event e) const;
+
+  // @return Number of queues subscribed to the given type
+  constexpr size_t subscriberCount(Event::Type type) const {
+    return m_counts[type];
+  }
+
+ private:
+  constexpr bool add(Event::Type type, EventQueue *queue) {
+    if (type >= Event::Type::kNumTypes
+        || m_counts[type] >= kMaxSubscribers) {
+      return false;
+    }
+
+    m_subscribers[type][m_counts[type]] = queue;
+    m_counts[type]++;
+    return true;
+  }
+
+  // @brief Add a payload reference for every subscriber past the first
+  // @return False (having released the payload) if there are no subscribers
+  static bool shareOrDrop(Event& e, size_t subscribers);
+
+  // @note Intentionally not constexpr, calling it during constant evaluation
+  //       is a compile error
+  static void tooManySubscribers() {}
+
+  EventQueue *m_subscribers[Event::Type::kNumTypes][kMaxSubscribers];
+  uint8_t m_counts[Event::Type::kNumTypes];
+};
+
+}
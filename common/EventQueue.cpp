@@ -4,49 +4,294 @@
 
 #include <mutex>
 
+#include "Delegate.h"
+#include "Histogram.h"
+#include "Stats.h"
+#if CAL_USE_EVENT_TIMESTAMPS
+#include "Clock.h"
+#endif
 #include "hal.h"
 
-EventQueue::EventQueue() {}
+EventQueue::EventQueue(cal::OverflowPolicy policy, systime_t blockTimeout)
+    : m_overflowPolicy(policy), m_blockTimeout(blockTimeout) {
+  // taken, the first push releases it
+  chBSemObjectInit(&m_notEmpty, true);
+  // taken, pops release it
+  chBSemObjectInit(&m_notFull, true);
+}
 
 Event EventQueue::pop() {
-  // acquire lock guard in current scope
-  std::lock_guard<chibios_rt::Mutex> lock(m_queueMut);
-  // pop item from queue and return
-  return m_queue.PopFront();
+  Event e;
+  tryPop(e);
+  return e;
+}
+
+bool EventQueue::tryPop(Event& e) {
+  if (!remove(e)) {
+    return false;
+  }
+
+  if (m_overflowPolicy == cal::OverflowPolicy::kBlock) {
+    syssts_t sts = chSysGetStatusAndLockX();
+    chBSemSignalI(&m_notFull);
+    chSysRestoreStatusX(sts);
+  }
+
+  if (m_trace != nullptr) {
+    m_trace->record(cal::EventTrace::kPop, m_traceId, e);
+  }
+#if CAL_USE_EVENT_TIMESTAMPS
+  if (m_latency != nullptr && e.timestamp() != 0) {
+    m_latency->record(cal::Clock::elapsedUs(e.timestamp()));
+  }
+#endif
+  return true;
 }
 
+/**
+ * @note An ISR can't wait for room, and a producer that tried is better told
+ *       than have its event dropped, so only kDropOldest still gets it in
+ */
 bool EventQueue::tryPush(Event e) {
-  // acquire lock in current scope
-  bool didAcquire = m_queueMut.tryLock();
-  //std::unique_lock<chibios_rt::Mutex> queueLock(m_queueMut,
-  //    std::try_to_lock);
-  if (!didAcquire) {
-    // don't push, indicate failure
+  cal::PushStatus status = insert(e, false,
+      m_overflowPolicy == cal::OverflowPolicy::kDropOldest);
+  if (status == cal::PushStatus::kRejected) {
+    recordOverflow(e);
+  }
+  if (!queued(status)) {
     return false;
-  } else {
-    // push item, indicate success
-    m_queue.PushBack(e);
-    m_queueMut.unlock();
-    return true;
   }
+  notify();
+  return true;
 }
 
-void EventQueue::push(Event e) {
-  // acquire lock in current scope
-  std::lock_guard<chibios_rt::Mutex> queueGuard(m_queueMut);
-  // push item
-  m_queue.PushBack(e);
+cal::PushStatus EventQueue::push(Event e) {
+  cal::PushStatus status = admit(e);
+  if (queued(status)) {
+    notify();
+  }
+  return status;
 }
 
 void EventQueue::push(std::vector<Event> events) {
-  // acquire lock in current scope
-  std::lock_guard<chibios_rt::Mutex> queueGuard(m_queueMut);
-  // push items
+  bool any = false;
   for (Event e : events) {
-    m_queue.PushBack(e);
+    any |= queued(admit(e));
+  }
+  if (any) {
+    notify();
+  }
+}
+
+/**
+ * @note A lock-free queue can't overwrite its oldest event, so kDropOldest
+ *       drops the newest one there
+ */
+cal::PushStatus EventQueue::admit(Event& e) {
+  cal::PushStatus status = insert(e, true,
+      m_overflowPolicy == cal::OverflowPolicy::kDropOldest);
+  if (status != cal::PushStatus::kRejected) {
+    return status;
+  }
+
+  switch (m_overflowPolicy) {
+    case cal::OverflowPolicy::kBlock:
+      return waitForRoom(e);
+    case cal::OverflowPolicy::kReject:
+      recordOverflow(e);
+      return cal::PushStatus::kRejected;
+    default:
+      recordOverflow(e);
+      // the queue took the event over, and drops it
+      e.releasePayload();
+      return cal::PushStatus::kDroppedNewest;
+  }
+}
+
+/**
+ * @note Every pop signals the semaphore, but several pops may coalesce into
+ *       one signal, so a producer that gets in passes the signal on to the
+ *       next blocked one, which retries
+ */
+cal::PushStatus EventQueue::waitForRoom(Event& e) {
+  systime_t start = chVTGetSystemTimeX();
+  while (true) {
+    systime_t timeout = m_blockTimeout;
+    if (timeout != TIME_INFINITE) {
+      systime_t elapsed = chVTTimeElapsedSinceX(start);
+      timeout = elapsed < m_blockTimeout ? m_blockTimeout - elapsed
+                                         : TIME_IMMEDIATE;
+    }
+    if (chBSemWaitTimeout(&m_notFull, timeout) != MSG_OK) {
+      recordOverflow(e);
+      return cal::PushStatus::kTimedOut;
+    }
+
+    cal::PushStatus status = insert(e, true, false);
+    if (status != cal::PushStatus::kRejected) {
+      syssts_t sts = chSysGetStatusAndLockX();
+      chBSemSignalI(&m_notFull);
+      chSysRestoreStatusX(sts);
+      return status;
+    }
+  }
+}
+
+bool EventQueue::queued(cal::PushStatus status) {
+  return status == cal::PushStatus::kOk
+      || status == cal::PushStatus::kDroppedOldest;
+}
+
+/**
+ * @note The semaphore remembers a push that happens between the ready() check
+ *       and the wait, so no wakeup is lost. It may also still be signaled by
+ *       pushes that were already popped, hence the loop.
+ */
+bool EventQueue::wait(systime_t timeout) {
+  while (!ready()) {
+    if (chBSemWaitTimeout(&m_notEmpty, timeout) != MSG_OK) {
+      return false;
+    }
   }
+
+  return true;
 }
 
-bool EventQueue::wait() { return false; }
+/**
+ * @note tryPush() is called from driver callbacks (ISR context) as well as
+ *       threads, so the kernel lock state is saved and restored instead of
+ *       using chSysLock() or chSysLockFromISR() directly
+ */
+void EventQueue::notify() {
+  syssts_t sts = chSysGetStatusAndLockX();
+  chBSemSignalI(&m_notEmpty);
+  cal::Delegate<void()> hook = m_pushHook;
+  chSysRestoreStatusX(sts);
+
+  if (hook) {
+    hook();
+  }
+}
+
+/**
+ * @note The high-water mark is raised with a compare-and-swap, lock-free
+ *       queues call this without a lock
+ */
+void EventQueue::recordPush(Event& e, size_t depth) {
+  if (m_trace != nullptr) {
+    m_trace->record(cal::EventTrace::kPush, m_traceId, e);
+  }
+
+  size_t highWater = m_highWater.load(std::memory_order_relaxed);
+  while (depth > highWater && !m_highWater.compare_exchange_weak(highWater,
+      depth, std::memory_order_relaxed)) {
+  }
+}
+
+void EventQueue::recordOverflow(Event& dropped) {
+  m_overflows.increment();
+  if (dropped.type() < Event::Type::kNumTypes) {
+    m_typeOverflows[dropped.type()].increment();
+  }
+  if (m_trace != nullptr) {
+    m_trace->record(cal::EventTrace::kOverflow, m_traceId, dropped);
+  }
+}
+
+/**
+ * @note Counted without the lock (it's the lock that couldn't be acquired),
+ *       with an atomic increment
+ */
+void EventQueue::recordFailedPush() { m_failedPushes.increment(); }
+
+size_t EventQueue::size() { return depth(); }
+
+bool EventQueue::ready() { return depth() > 0; }
+
+size_t EventQueue::highWater() {
+  return m_highWater.load(std::memory_order_relaxed);
+}
+
+uint32_t EventQueue::overflows() { return m_overflows.value(); }
+
+uint32_t EventQueue::overflows(Event::Type type) {
+  return type < Event::Type::kNumTypes ? m_typeOverflows[type].value() : 0;
+}
+
+cal::OverflowPolicy EventQueue::overflowPolicy() { return m_overflowPolicy; }
+
+uint32_t EventQueue::failedPushes() { return m_failedPushes.value(); }
+
+void EventQueue::setTrace(cal::EventTrace *trace, uint8_t id) {
+  m_trace = trace;
+  m_traceId = id;
+}
+
+void EventQueue::setLatencyHistogram(cal::Histogram *latency) {
+  m_latency = latency;
+}
+
+void EventQueue::setPushHook(cal::Delegate<void()> hook) {
+  syssts_t sts = chSysGetStatusAndLockX();
+  m_pushHook = hook;
+  chSysRestoreStatusX(sts);
+}
+
+void EventQueue::resetStats() {
+  m_highWater.store(size(), std::memory_order_relaxed);
+  m_overflows.reset();
+  for (cal::Counter& overflows : m_typeOverflows) {
+    overflows.reset();
+  }
+  m_failedPushes.reset();
+}
+
+void EventQueue::registerStats(const char *group) {
+  cal::Stats::add(group, "depth", [] (void *arg) -> uint32_t {
+    return static_cast<EventQueue *>(arg)->size();
+  }, this);
+  cal::Stats::add(group, "highWater", [] (void *arg) -> uint32_t {
+    return static_cast<EventQueue *>(arg)->highWater();
+  }, this);
+  cal::Stats::add(group, "overflows", m_overflows);
+  cal::Stats::add(group, "failedPushes", m_failedPushes);
+}
+
+void EventQueue::registerOverflowStats(const char *group) {
+  static const char *const names[] = { "overflows.none", "overflows.canRx",
+    "overflows.timerTimeout", "overflows.adcConversion",
+    "overflows.digInTransition", "overflows.uartRx" };
+  static_assert(sizeof(names) / sizeof(names[0]) == Event::Type::kNumTypes,
+      "a name per event type");
+
+  for (size_t type = 0; type < Event::Type::kNumTypes; type++) {
+    cal::Stats::add(group, names[type], m_typeOverflows[type]);
+  }
+}
+
+void cal::MutexPolicy::lock() { m_mutex.lock(); }
+
+/**
+ * @note Mutexes are threads only, a tryPush() from an ISR fails (counted as
+ *       a failed push) instead of corrupting the mutex
+ */
+bool cal::MutexPolicy::tryLock() {
+  chDbgAssert(!port_is_isr_context(), "mutex queues are threads only");
+  if (port_is_isr_context()) {
+    return false;
+  }
+  return m_mutex.tryLock();
+}
+
+void cal::MutexPolicy::unlock() { m_mutex.unlock(); }
+
+void cal::CriticalSectionPolicy::lock() {
+  m_status = chSysGetStatusAndLockX();
+}
+
+bool cal::CriticalSectionPolicy::tryLock() {
+  lock();
+  return true;
+}
 
-size_t EventQueue::size() { return m_queue.Size(); }
+void cal::CriticalSectionPolicy::unlock() { chSysRestoreStatusX(m_status); }
@@ -2,47 +2,367 @@
 
 #include <stdint.h>
 
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <vector>
 
 #include "CircularBuffer.h"
+#include "Delegate.h"
 #include "Event.h"
+#include "EventTrace.h"
+#include "Histogram.h"
+#include "Stats.h"
 #include "ch.hpp"
 #include "hal.h"
 
+namespace cal {
+
+/**
+ * @brief What a push to a full EventQueue does
+ */
+enum class OverflowPolicy : uint8_t {
+  // leave the new event with the caller, push() returns kRejected
+  kReject,
+  // overwrite the oldest queued event, push() returns kDroppedOldest
+  kDropOldest,
+  // drop the new event (releasing its payload), push() returns kDroppedNewest
+  kDropNewest,
+  // wait for the consumer to make room, up to the queue's block timeout.
+  // Threads only, tryPush() rejects instead.
+  kBlock
+};
+
+/**
+ * @brief Outcome of an EventQueue push
+ */
+enum class PushStatus : uint8_t {
+  // queued
+  kOk,
+  // queued, the oldest event was dropped to make room
+  kDroppedOldest,
+  // not queued, the queue dropped it
+  kDroppedNewest,
+  // not queued, the event (and its payload) stays with the caller
+  kRejected,
+  // not queued after blocking for the timeout, stays with the caller
+  kTimedOut,
+  // tryPush() couldn't acquire the queue, stays with the caller
+  kBusy
+};
+
+}
+
 /*
  * @brief Thread-safe FIFO queue of events
+ *
+ * The interface producers and consumers hold references to. Queues are
+ * instantiated as a cal::BasicEventQueue, whose policy picks how pushes and
+ * pops are synchronized, so each queue can pick the cheapest one its
+ * producers allow, and an overflow policy deciding what pushes to a full
+ * queue do. Every event a full queue doesn't deliver is counted as an
+ * overflow, per event type, so queues can be sized from measurements.
  */
 class EventQueue {
  private:
-  CircularBuffer<Event> m_queue{20};
-  chibios_rt::Mutex m_queueMut;
+  // signaled on every push, taken by wait()
+  binary_semaphore_t m_notEmpty;
+
+  // signaled on every pop of a blocking queue, taken by blocked pushes
+  binary_semaphore_t m_notFull;
+
+  cal::OverflowPolicy m_overflowPolicy;
+  systime_t m_blockTimeout;
+
+  // statistics, updated by the backends where events go in and out
+  std::atomic<size_t> m_highWater{0};
+  cal::Counter m_overflows;
+  std::array<cal::Counter, Event::Type::kNumTypes> m_typeOverflows;
+  cal::Counter m_failedPushes;
+
+  // trace ring every push and pop is recorded to, if tracing is enabled
+  cal::EventTrace *m_trace = nullptr;
+  uint8_t m_traceId = 0;
+
+  // histogram of event latency at pop, if enabled
+  cal::Histogram *m_latency = nullptr;
+
+  // called after every push, e.g. to wake a consumer not blocked in wait()
+  cal::Delegate<void()> m_pushHook;
+
+  // @brief Wake a consumer blocked in wait(), callable from any context
+  void notify();
+
+  // @brief Insert an event, handling a full queue per the overflow policy
+  cal::PushStatus admit(Event& e);
+
+  // @brief Retry a push to a full kBlock queue until there's room or the
+  //        block timeout expires
+  cal::PushStatus waitForRoom(Event& e);
+
+  // @return True if the status means the event was queued
+  static bool queued(cal::PushStatus status);
+
+ protected:
+  EventQueue(cal::OverflowPolicy policy, systime_t blockTimeout);
+
+  /**
+   * @brief Add an event at the back, accounting for it with recordPush()
+   * @param wait True for push(), which may wait for the queue (e.g. on a
+   *        mutex). False for tryPush(), a push that would wait returns kBusy
+   *        and is counted with recordFailedPush().
+   * @param overwrite Whether a full queue overwrites its oldest event,
+   *        accounting for it with recordOverflow() and returning
+   *        kDroppedOldest
+   * @return kOk, kDroppedOldest, kBusy, or kRejected if the queue is full
+   *         (and not overwritten), which the caller accounts for
+   */
+  virtual cal::PushStatus insert(Event& e, bool wait, bool overwrite) = 0;
+
+  // @brief Take the event at the front
+  // @return False if the queue is empty
+  virtual bool remove(Event& e) = 0;
+
+  // @return Number of queued events
+  virtual size_t depth() = 0;
+
+  // @return Whether remove() would take an event right now
+  virtual bool ready();
+
+  // @brief Account for an event that was just added, leaving depth events
+  void recordPush(Event& e, size_t depth);
+
+  // @brief Account for an event that was dropped (overwritten or rejected)
+  //        because the queue was full
+  void recordOverflow(Event& dropped);
+
+  // @brief Account for a non-blocking push that couldn't get in
+  void recordFailedPush();
 
  public:
-  EventQueue();
+  virtual ~EventQueue() = default;
+
+  // instances are referenced by their producers and consumer
+  EventQueue(const EventQueue&) = delete;
+  EventQueue& operator=(const EventQueue&) = delete;
 
   // @brief thread-safe queue pop
+  // @return The event at the front, Event() if the queue is empty
   // TODO: Rename to, correct, dequeue
   Event pop();
 
+  // @brief thread-safe queue pop, telling an empty queue apart from a
+  //        popped Event() (e.g. for draining loops)
+  // @param e Set to the event at the front
+  // @return False if there's no event to pop, e is left as is
+  bool tryPop(Event& e);
+
   // @brief thread-safe non-blocking queue push, at the cost of
   //        potential failure to push
   // @return Success in pushing as true, Failure to push as false
+  // @note Pushing hands the event's payload reference (if any) to the
+  //       queue, a failed push leaves it with the caller. A full queue never
+  //       blocks (kBlock) or drops (kDropNewest) a tryPush(), it rejects it.
   bool tryPush(Event e);
 
-  // @brief thread-safe queue push
+  // @brief thread-safe queue push, handling a full queue per its overflow
+  //        policy
+  // @return Whether and how the event was queued, see cal::PushStatus
   // TODO: Rename to, correct, enqueue
-  void push(Event e);
+  cal::PushStatus push(Event e);
   void push(std::vector<Event> events);
 
-  // ------------------------ WIP ------------------------
-  // @brief Wait (block) until the queue becomes non-empty.
-  // @param timeout US before call times out
+  // @brief Wait (block) until the queue becomes non-empty. Only one thread
+  //        (the queue's consumer) may wait on a queue.
+  // @param timeout System ticks before call times out
   // @return True if queue is now non-empty, false if timed out
-  // TODO: Implement using condition vars against the circ buffer's
-  //       size
-  bool wait();
+  bool wait(systime_t timeout = TIME_INFINITE);
 
   // @return The length of the event queue
+  // @note Lock-free queues also count events whose producers are still
+  //       writing them, which can't be popped yet, so drain queues with
+  //       tryPop() rather than by size()
   size_t size();
+
+  // @return Max length the queue reached since the last resetStats()
+  size_t highWater();
+
+  // @return Number of events a full queue didn't deliver (rejected,
+  //         dropped or timed out)
+  uint32_t overflows();
+
+  // @return Number of overflows of events of one type
+  uint32_t overflows(Event::Type type);
+
+  cal::OverflowPolicy overflowPolicy();
+
+  // @return Number of tryPush() calls that failed to acquire the queue
+  uint32_t failedPushes();
+
+  void resetStats();
+
+  /**
+   * @brief Register the queue's depth, high-water mark, overflows and failed
+   *        pushes in cal::Stats
+   * @param group Name the queue's stats are listed under, e.g. its consumer's
+   */
+  void registerStats(const char *group);
+
+  /**
+   * @brief Register the queue's overflows per event type in cal::Stats, as
+   *        "overflows.<type>", e.g. while sizing the queue
+   * @param group Name the queue's stats are listed under
+   */
+  void registerOverflowStats(const char *group);
+
+  /**
+   * @brief Record every push and pop of this queue to a trace ring
+   * @param trace Ring to record to, nullptr disables tracing
+   * @param id Trace ID telling this queue's records apart from those of
+   *        other queues sharing the ring
+   * @note Set up before the queue is used
+   */
+  void setTrace(cal::EventTrace *trace, uint8_t id);
+
+  /**
+   * @brief Record the latency of every popped event, from when it was
+   *        stamped (usually when it was produced and pushed) to its pop, in
+   *        microseconds
+   * @param latency Histogram to record to, nullptr disables recording
+   * @note Requires CAL_USE_EVENT_TIMESTAMPS, nothing is recorded otherwise.
+   *       Unstamped events aren't recorded either. Set up before the queue
+   *       is used.
+   */
+  void setLatencyHistogram(cal::Histogram *latency);
+
+  /**
+   * @brief Call hook after every push, for consumers that don't block in
+   *        wait() (e.g. tasks of a cal::TaskScheduler)
+   * @note Called from the pushing context, which may be an ISR
+   */
+  void setPushHook(cal::Delegate<void()> hook);
+};
+
+namespace cal {
+
+/**
+ * @brief Synchronize with a ChibiOS mutex (with priority inheritance)
+ *
+ * Cheap while uncontended by threads. Threads only: ChibiOS mutexes can't be
+ * used from ISRs, so queues with producers in ISRs (e.g. driver callbacks)
+ * use cal::CriticalSectionPolicy or cal::LockFreePolicy instead.
+ */
+class MutexPolicy {
+ public:
+  void lock();
+  bool tryLock();
+  void unlock();
+
+ private:
+  chibios_rt::Mutex m_mutex;
+};
+
+/**
+ * @brief Synchronize with a kernel critical section
+ *
+ * Callable from threads and ISRs alike, and tryPush() never fails, at the
+ * cost of masking interrupts for the duration of each push and pop.
+ */
+class CriticalSectionPolicy {
+ public:
+  void lock();
+  bool tryLock();
+  void unlock();
+
+ private:
+  // only one context can be in the critical section, so one saved status
+  syssts_t m_status = 0;
+};
+
+/**
+ * @brief Don't lock, use a lock-free multi-producer, single-consumer ring
+ *
+ * Pushes from any context never block or mask interrupts. A full queue
+ * can't overwrite its oldest event.
+ */
+struct LockFreePolicy {};
+
+/**
+ * @brief EventQueue holding up to Capacity events, synchronized per Policy
+ *
+ * @tparam Policy cal::MutexPolicy or cal::CriticalSectionPolicy, or
+ *         cal::LockFreePolicy for the lock-free ring
+ * @tparam Capacity Max number of queued events
+ */
+template <class Policy, size_t Capacity = 20>
+class BasicEventQueue : public EventQueue {
+ public:
+  /**
+   * @param policy What a push to the full queue does
+   * @param blockTimeout System ticks a kBlock push waits for room
+   */
+  explicit BasicEventQueue(
+      cal::OverflowPolicy policy = cal::OverflowPolicy::kDropOldest,
+      systime_t blockTimeout = TIME_INFINITE);
+
+ protected:
+  cal::PushStatus insert(Event& e, bool wait, bool overwrite) override;
+  bool remove(Event& e) override;
+  size_t depth() override;
+
+ private:
+  CircularBuffer<Event> m_queue{Capacity};
+  Policy m_policy;
+};
+
+/**
+ * @brief Bounded lock-free EventQueue (Vyukov's sequenced ring)
+ *
+ * Every slot has a sequence number telling producers and the consumer whose
+ * turn it is: producers claim slots by advancing the enqueue position with a
+ * compare-and-swap (LDREX/STREX on Cortex-M), write the event, then publish it
+ * by bumping the slot's sequence. A producer never waits on another one
+ * except to retry a lost compare-and-swap.
+ *
+ * @tparam Capacity Number of slots, a power of two (positions wrap)
+ *
+ * @note Single consumer only, pops aren't synchronized with each other
+ * @note A producer interrupted between claiming and publishing a slot
+ *       holds up pops of later slots until it resumes
+ * @note Producers can't take the consumer's oldest event, kDropOldest drops
+ *       the newest one instead
+ */
+template <size_t Capacity>
+class BasicEventQueue<LockFreePolicy, Capacity> : public EventQueue {
+ public:
+  static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0,
+      "lock-free queue capacity must be a power of two");
+
+  explicit BasicEventQueue(
+      cal::OverflowPolicy policy = cal::OverflowPolicy::kDropNewest,
+      systime_t blockTimeout = TIME_INFINITE);
+
+ protected:
+  cal::PushStatus insert(Event& e, bool wait, bool overwrite) override;
+  bool remove(Event& e) override;
+  size_t depth() override;
+  bool ready() override;
+
+ private:
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    Event event;
+  };
+
+  std::array<Slot, Capacity> m_slots;
+  std::atomic<uint32_t> m_enqueuePos{0};
+  std::atomic<uint32_t> m_dequeuePos{0};
 };
+
+using MutexEventQueue = BasicEventQueue<MutexPolicy>;
+using CriticalSectionEventQueue = BasicEventQueue<CriticalSectionPolicy>;
+using LockFreeEventQueue = BasicEventQueue<LockFreePolicy, 32>;
+
+}
+
+#include "EventQueue.inc"
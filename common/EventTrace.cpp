@@ -0,0 +1,125 @@
+#include "EventTrace.h"
+
+#include <stdint.h>
+
+#include "Event.h"
+#include "ch.h"
+
+// Definitions for static members
+constexpr size_t cal::EventTrace::kCapacity;
+constexpr size_t cal::EventTrace::kRecordSize;
+constexpr size_t cal::EventTrace::kHeaderSize;
+constexpr uint16_t cal::EventTrace::kIsrProducer;
+
+void cal::EventTrace::record(Op op, uint8_t queueId, Event& event) {
+  Record r = {static_cast<uint32_t>(chSysGetRealtimeCounterX()), op, queueId,
+    producerId(), event};
+
+  syssts_t sts = chSysGetStatusAndLockX();
+  if (m_length == kCapacity) {
+    // drop the oldest record to make room
+    m_front = (m_front + 1) % kCapacity;
+    m_length--;
+    m_lost++;
+  }
+  m_records[(m_front + m_length) % kCapacity] = r;
+  m_length++;
+  chSysRestoreStatusX(sts);
+}
+
+size_t cal::EventTrace::read(uint8_t *buf, size_t len) {
+  if (len < kHeaderSize + kRecordSize) {
+    return 0;
+  }
+
+  size_t count = 0;
+  size_t maxCount = (len - kHeaderSize) / kRecordSize;
+  uint8_t *out = buf + kHeaderSize;
+  while (count < maxCount) {
+    // copy one record at a time, so the lock is only held briefly
+    syssts_t sts = chSysGetStatusAndLockX();
+    if (m_length == 0) {
+      chSysRestoreStatusX(sts);
+      break;
+    }
+    Record r = m_records[m_front];
+    m_front = (m_front + 1) % kCapacity;
+    m_length--;
+    chSysRestoreStatusX(sts);
+
+    for (size_t b = 0; b < 4; b++) {
+      out[b] = static_cast<uint8_t>(r.cycles >> (8*b));
+    }
+    out[4] = r.op;
+    out[5] = r.queueId;
+    out[6] = static_cast<uint8_t>(r.producerId & 0xFF);
+    out[7] = static_cast<uint8_t>(r.producerId >> 8);
+    r.event.serialize(out + 8);
+
+    out += kRecordSize;
+    count++;
+  }
+
+  if (count == 0) {
+    return 0;
+  }
+
+  buf[0] = 'T';
+  buf[1] = 'R';
+  buf[2] = static_cast<uint8_t>(count & 0xFF);
+  buf[3] = static_cast<uint8_t>(count >> 8);
+  return kHeaderSize + count * kRecordSize;
+}
+
+size_t cal::EventTrace::size() const { return m_length; }
+
+uint32_t cal::EventTrace::lost() const { return m_lost; }
+
+size_t cal::EventTrace::replay(const uint8_t *stream, size_t len,
+    std::function<void(Record&)> handler) {
+  size_t decoded = 0;
+  size_t pos = 0;
+
+  while (pos + kHeaderSize <= len) {
+    if (stream[pos] != 'T' || stream[pos + 1] != 'R') {
+      break;
+    }
+    size_t count = stream[pos + 2] | (stream[pos + 3] << 8);
+    pos += kHeaderSize;
+    if (pos + count * kRecordSize > len) {
+      break;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      const uint8_t *in = stream + pos;
+      Record r;
+      r.cycles = static_cast<uint32_t>(in[0])
+          | (static_cast<uint32_t>(in[1]) << 8)
+          | (static_cast<uint32_t>(in[2]) << 16)
+          | (static_cast<uint32_t>(in[3]) << 24);
+      r.op = in[4] <= kOverflow ? static_cast<Op>(in[4]) : kOverflow;
+      r.queueId = in[5];
+      r.producerId = static_cast<uint16_t>(in[6] | (in[7] << 8));
+      r.event = Event::deserialize(in + 8);
+
+      handler(r);
+      pos += kRecordSize;
+      decoded++;
+    }
+  }
+
+  return decoded;
+}
+
+/**
+ * @note Thread descriptors live in RAM a few KB apart at most, so the low
+ *       half of their address tells threads apart (and matches what a
+ *       debugger shows)
+ */
+uint16_t cal::EventTrace::producerId() {
+  if (port_is_isr_context()) {
+    return kIsrProducer;
+  }
+
+  return static_cast<uint16_t>(reinterpret_cast<uintptr_t>(chThdGetSelfX()));
+}
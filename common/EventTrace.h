@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <array>
+#include <functional>
+
+#include "Event.h"
+
+namespace cal {
+
+/**
+ * @brief Fixed RAM ring of event records, capturing what flowed through one
+ *        or more EventQueues
+ *
+ * Tracing is opt-in per queue (EventQueue::setTrace()), every push and pop of
+ * a traced queue appends a record with a cycle counter timestamp, the queue's
+ * trace ID, the producing context and the full event. When the ring is full,
+ * the oldest records are overwritten and counted as lost.
+ *
+ * The ring is drained in batches with read(), e.g. by a low priority thread
+ * that sends them over UART whenever the TX queue has room. A batch is
+ * (all integers little-endian):
+ *
+ *   'T' 'R' <uint16 count> count * { <uint32 cycles> <uint8 op>
+ *       <uint8 queue ID> <uint16 producer ID> <Event, 21 bytes> }
+ *
+ * replay() decodes a captured stream of batches and hands every record to a
+ * handler in capture order, so the same consumer code (e.g. an ActiveObject's
+ * handle() or Hsm::dispatch()) can be fed the exact sequence it saw on
+ * target.
+ *
+ * @note record() may be called from ISRs, it holds the kernel lock for the
+ *       copy of one record
+ */
+class EventTrace {
+ public:
+  enum Op : uint8_t { kPush, kPop, kOverflow };
+
+  struct Record {
+    // realtime (cycle) counter at the time of the operation
+    uint32_t cycles;
+    Op op;
+    uint8_t queueId;
+    uint16_t producerId;
+    Event event;
+  };
+
+  // Number of records held in RAM
+  static constexpr size_t kCapacity = 64;
+
+  // Size of a record's binary representation
+  static constexpr size_t kRecordSize = 8 + Event::kSerializedSize;
+
+  // Size of a batch header ('T' 'R' <uint16 count>)
+  static constexpr size_t kHeaderSize = 4;
+
+  // Producer ID of events pushed from ISRs (including driver callbacks)
+  static constexpr uint16_t kIsrProducer = 0;
+
+  /**
+   * @brief Append a record, overwriting the oldest one if the ring is full
+   * @note Callable from any context
+   */
+  void record(Op op, uint8_t queueId, Event& event);
+
+  /**
+   * @brief Move the oldest records into a batch
+   * @param buf Buffer to write the batch to
+   * @param len Size of buf, only whole records are written
+   * @return Bytes written to buf, 0 if the ring is empty or buf can't hold
+   *         one record
+   */
+  size_t read(uint8_t *buf, size_t len);
+
+  // @return Number of records waiting to be read
+  size_t size() const;
+
+  // @return Number of records overwritten before they were read
+  uint32_t lost() const;
+
+  /**
+   * @brief Decode a captured stream of batches
+   * @param handler Called for every record, in capture order
+   * @return Number of records decoded, decoding stops at the first malformed
+   *         batch
+   */
+  static size_t replay(const uint8_t *stream, size_t len,
+      std::function<void(Record&)> handler);
+
+  // @return ID of the calling context, kIsrProducer from ISRs, otherwise the
+  //         low half of the calling thread's descriptor address
+  static uint16_t producerId();
+
+ private:
+  std::array<Record, kCapacity> m_records;
+
+  // index of the oldest record, and number of records in the ring
+  size_t m_front = 0;
+  size_t m_length = 0;
+
+  uint32_t m_lost = 0;
+};
+
+}
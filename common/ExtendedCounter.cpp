@@ -0,0 +1,14 @@
+#include "ExtendedCounter.h"
+
+cal::ExtendedCounter::ExtendedCounter(uint32_t count) : m_value(count) {}
+
+/**
+ * @note The elapsed ticks are computed with unsigned 32 bit subtraction, so a
+ *       single wrap between readings is accounted for automatically
+ */
+uint64_t cal::ExtendedCounter::extend(uint32_t count) {
+  m_value += static_cast<uint32_t>(count - static_cast<uint32_t>(m_value));
+  return m_value;
+}
+
+uint64_t cal::ExtendedCounter::value() const { return m_value; }
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace cal {
+
+/**
+ * @brief Extends a free-running 32 bit counter to 64 bits
+ *
+ * Every reading of the hardware counter is fed to extend(), which adds the
+ * ticks since the previous reading (mod 2^32) to a 64 bit total. The low 32
+ * bits of the total are always the raw counter value.
+ *
+ * @note This class has no ChibiOS dependencies, so wraps can be simulated in
+ *       unit tests
+ * @note The counter must be read at least once per wrap, and readings must be
+ *       fed in the order they were taken. Callers must serialize all calls
+ *       (e.g. read the counter and call extend() within the kernel lock).
+ */
+class ExtendedCounter {
+ public:
+  // @param count Raw counter value the total starts at
+  explicit ExtendedCounter(uint32_t count = 0);
+
+  // @return 64 bit total for a new reading of the counter
+  uint64_t extend(uint32_t count);
+
+  // @return 64 bit total as of the last reading
+  uint64_t value() const;
+
+ private:
+  uint64_t m_value;
+};
+
+}
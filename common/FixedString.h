@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <type_traits>
+
+namespace cal {
+
+/**
+ * @brief Non-owning view of a run of characters, e.g. a string literal or a
+ *        cal::FixedString (this toolchain's library has no std::string_view)
+ */
+class StringView {
+ public:
+  constexpr StringView() = default;
+
+  // @brief View a null-terminated string, without its terminator
+  constexpr StringView(const char *str) : m_data(str), m_size(length(str)) {}
+
+  constexpr StringView(const char *data, size_t size)
+      : m_data(data), m_size(size) {}
+
+  // @note Not null-terminated unless what's viewed is
+  constexpr const char *data() const { return m_data; }
+
+  constexpr size_t size() const { return m_size; }
+
+  constexpr bool empty() const { return m_size == 0; }
+
+  constexpr char operator[](size_t i) const { return m_data[i]; }
+
+ private:
+  static constexpr size_t length(const char *str) {
+    size_t n = 0;
+    while (str[n] != '\0') {
+      n++;
+    }
+    return n;
+  }
+
+  const char *m_data = "";
+  size_t m_size = 0;
+};
+
+/**
+ * @brief String of up to N characters stored inline, for composing messages
+ *        (e.g. log lines) without touching the heap
+ *
+ * Appending past the capacity truncates, and is remembered by truncated().
+ * Integers are formatted in decimal by append() and operator<<, which are
+ * constexpr, and format() appends anything chprintf can format.
+ *
+ * @code
+ *   cal::FixedString<64> line;
+ *   line << "EventSim: Ran [" << testCount << "] tests.\n";
+ *   uart.send(line);
+ * @endcode
+ *
+ * @tparam N Max number of characters, the buffer has one more for the null
+ *         terminator
+ */
+template <size_t N>
+class FixedString {
+ public:
+  constexpr FixedString() = default;
+
+  constexpr FixedString(cal::StringView str);
+
+  constexpr FixedString& append(cal::StringView str);
+  constexpr FixedString& append(const char *str);
+  constexpr FixedString& append(char c);
+
+  // @brief Append an integer in decimal
+  template <class Integer>
+  constexpr typename std::enable_if<std::is_integral<Integer>::value,
+      FixedString&>::type append(Integer number);
+
+  // @brief Stream-style append(), for chaining the parts of a message
+  template <class T>
+  constexpr FixedString& operator<<(T value);
+
+  /**
+   * @brief Append chprintf-style formatted text, e.g. hex or padded numbers
+   * @note Not constexpr, formatting is done by chvsnprintf
+   */
+  FixedString& format(const char *fmt, ...);
+
+  constexpr void clear();
+
+  // @return The characters, null-terminated
+  constexpr const char *c_str() const { return m_data; }
+  constexpr const char *data() const { return m_data; }
+
+  constexpr size_t size() const { return m_size; }
+  constexpr bool empty() const { return m_size == 0; }
+  static constexpr size_t capacity() { return N; }
+
+  // @return Whether anything appended since the last clear() didn't fit
+  constexpr bool truncated() const { return m_truncated; }
+
+  constexpr operator cal::StringView() const {
+    return cal::StringView(m_data, m_size);
+  }
+
+ private:
+  char m_data[N + 1] = {};
+  size_t m_size = 0;
+  bool m_truncated = false;
+};
+
+}
+
+#include "FixedString.inc"
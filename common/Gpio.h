@@ -4,6 +4,7 @@
 //       well with digital-only inputs
 enum class Gpio { kA1 = 0, kA2, kA3, kA6 };
 
-enum class DigitalInput { kTriStateUp = 0 };
+enum class DigitalInput { kTriStateUp = 0, kTriStateDown, kDriveModeButton,
+  kBspdFault };
 
 enum class UartInterface { kD3 };
@@ -0,0 +1,108 @@
+#include "Histogram.h"
+
+#include <atomic>
+
+// Definitions for static members
+constexpr size_t cal::Histogram::kSubBucketBits;
+constexpr size_t cal::Histogram::kSubBuckets;
+constexpr size_t cal::Histogram::kValueBits;
+constexpr uint32_t cal::Histogram::kMaxValue;
+constexpr size_t cal::Histogram::kBuckets;
+
+cal::Histogram::Histogram() { reset(); }
+
+/**
+ * @note The bucket is counted before the total, so a snapshot that has seen a
+ *       record in the total has also seen it in its bucket
+ */
+void cal::Histogram::record(uint32_t value) {
+  m_counts[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+  m_count.fetch_add(1, std::memory_order_relaxed);
+
+  uint32_t max = m_max.load(std::memory_order_relaxed);
+  while (value > max && !m_max.compare_exchange_weak(max, value,
+      std::memory_order_relaxed)) {
+  }
+}
+
+cal::Histogram::Snapshot cal::Histogram::snapshot() {
+  return takeSnapshot(false);
+}
+
+cal::Histogram::Snapshot cal::Histogram::snapshotAndReset() {
+  return takeSnapshot(true);
+}
+
+void cal::Histogram::reset() {
+  for (std::atomic<uint32_t>& count : m_counts) {
+    count.store(0, std::memory_order_relaxed);
+  }
+  m_count.store(0, std::memory_order_relaxed);
+  m_max.store(0, std::memory_order_relaxed);
+}
+
+size_t cal::Histogram::bucket(uint32_t value) {
+  if (value > kMaxValue) {
+    value = kMaxValue;
+  }
+  if (value < kSubBuckets) {
+    return value;
+  }
+
+  // the top kSubBucketBits + 1 bits select the bucket
+  size_t shift = 31 - __builtin_clz(value) - kSubBucketBits;
+  return (shift + 1) * kSubBuckets + ((value >> shift) & (kSubBuckets - 1));
+}
+
+uint32_t cal::Histogram::bucketMax(size_t bucket) {
+  if (bucket < kSubBuckets) {
+    return bucket;
+  }
+
+  size_t shift = bucket / kSubBuckets - 1;
+  uint32_t low = static_cast<uint32_t>(kSubBuckets + bucket % kSubBuckets)
+      << shift;
+  return low + (1u << shift) - 1;
+}
+
+/**
+ * @note Percentiles are resolved in a single pass over the buckets against
+ *       the total read up front, so buckets are read (and cleared) one at a
+ *       time without ever holding a copy of the whole histogram
+ */
+cal::Histogram::Snapshot cal::Histogram::takeSnapshot(bool reset) {
+  Snapshot s;
+  s.count = reset ? m_count.exchange(0, std::memory_order_relaxed)
+      : m_count.load(std::memory_order_relaxed);
+  s.max = reset ? m_max.exchange(0, std::memory_order_relaxed)
+      : m_max.load(std::memory_order_relaxed);
+
+  // ranks of the percentiles, in 1/1000, rounded up
+  static constexpr uint32_t kPermille[] = {500, 900, 990, 999};
+  uint32_t *percentiles[] = {&s.p50, &s.p90, &s.p99, &s.p999};
+  constexpr size_t kNumPercentiles = sizeof(kPermille) / sizeof(kPermille[0]);
+
+  size_t next = 0;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBuckets; i++) {
+    uint32_t count = reset
+        ? m_counts[i].exchange(0, std::memory_order_relaxed)
+        : m_counts[i].load(std::memory_order_relaxed);
+    if (count == 0) {
+      continue;
+    }
+
+    seen += count;
+    while (next < kNumPercentiles && seen * 1000
+        >= static_cast<uint64_t>(s.count) * kPermille[next]) {
+      uint32_t bound = bucketMax(i);
+      *percentiles[next++] = bound < s.max ? bound : s.max;
+    }
+  }
+
+  while (next < kNumPercentiles) {
+    *percentiles[next++] = s.max;
+  }
+
+  return s;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <array>
+#include <atomic>
+
+namespace cal {
+
+/**
+ * @brief Fixed-size log-linear histogram for latency percentiles
+ *
+ * Values below kSubBuckets get a bucket each, above that every power of two
+ * is split into kSubBuckets linear buckets, so a bucket is never wider than
+ * 1/kSubBuckets (12.5%) of the values it holds. Integer-only, recording is a
+ * count-leading-zeros and two relaxed atomic increments, so it's O(1) and
+ * lock-free (LDREX/STREX on Cortex-M) from any context, including ISRs.
+ *
+ * Percentiles are read from snapshots, typically taken and reset once per
+ * reporting period so each period shows its own tail.
+ *
+ * @note This class has no ChibiOS dependencies, values are in caller-defined
+ *       units (e.g. microseconds), so it can be driven with synthetic data in
+ *       unit tests and benchmarks
+ * @note Values above kMaxValue are counted in the last bucket, max is still
+ *       exact
+ * @note Records racing with snapshotAndReset() may be counted partly in
+ *       either period, percentiles that can't be resolved fall back to max
+ */
+class Histogram {
+ public:
+  static constexpr size_t kSubBucketBits = 3;
+  static constexpr size_t kSubBuckets = 1 << kSubBucketBits;
+
+  // Largest value with its own bucket, ~16.7 s in microseconds
+  static constexpr size_t kValueBits = 24;
+  static constexpr uint32_t kMaxValue = (1u << kValueBits) - 1;
+
+  static constexpr size_t kBuckets =
+      (kValueBits - kSubBucketBits + 1) * kSubBuckets;
+
+  struct Snapshot {
+    uint32_t count;
+    uint32_t max;
+
+    // upper bounds of the buckets holding each percentile, capped at max
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t p999;
+  };
+
+  Histogram();
+
+  // instances are referenced by address from the paths they measure
+  Histogram(const Histogram&) = delete;
+  Histogram& operator=(const Histogram&) = delete;
+
+  // @brief Count a value, callable from any context
+  void record(uint32_t value);
+
+  // @return Percentiles of everything recorded since the last reset
+  Snapshot snapshot();
+
+  // @brief Take a snapshot and start a new period
+  Snapshot snapshotAndReset();
+
+  void reset();
+
+  // @return Index of the bucket counting value
+  static size_t bucket(uint32_t value);
+
+  // @return Largest value counted in a bucket
+  static uint32_t bucketMax(size_t bucket);
+
+ private:
+  Snapshot takeSnapshot(bool reset);
+
+  std::array<std::atomic<uint32_t>, kBuckets> m_counts;
+  std::atomic<uint32_t> m_count;
+  std::atomic<uint32_t> m_max;
+};
+
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Event.h"
+
+namespace cal {
+
+/**
+ * @brief Compile-time description of a hierarchical state machine
+ *
+ * States and transitions are given as constant arrays. At construction, every
+ * state's handlers are flattened into a [state][Event::Type] jump table: a
+ * state that doesn't handle an event type inherits the handler of its closest
+ * ancestor that does. Looking up the handler for an event is therefore a
+ * single table index, regardless of state count or nesting depth.
+ *
+ * Declare the table constexpr so it's built by the compiler and placed in
+ * flash:
+ *
+ *   static constexpr cal::HsmTable<Fsm, 3>::State kStates[] = {...};
+ *   static constexpr cal::HsmTable<Fsm, 3>::Transition kTransitions[] = {...};
+ *   static constexpr cal::HsmTable<Fsm, 3> kTable(kStates, kTransitions, 0);
+ *
+ * @tparam Context Object handlers and actions operate on (e.g. the module
+ *         owning the state machine)
+ * @tparam NumStates Number of states, at most kNoState
+ */
+template <class Context, size_t NumStates>
+class HsmTable {
+ public:
+  using StateId = uint8_t;
+
+  // Parent of top-level states, "no initial substate" and "stay in the
+  // current state" (handler return value)
+  static constexpr StateId kNoState = 0xFF;
+
+  static_assert(NumStates > 0 && NumStates < kNoState,
+      "cal::HsmTable state count must fit in a StateId");
+
+  // Entry or exit action
+  using Action = void (*)(Context& ctx);
+
+  // Event handler, returns the state to transition to or kNoState to stay
+  using Handler = StateId (*)(Context& ctx, Event& e);
+
+  struct State {
+    // Enclosing state, kNoState for top-level states
+    StateId parent;
+    // Substate entered when this state is the target of a transition,
+    // kNoState for leaf states
+    StateId initial;
+    // Optional (nullptr) entry and exit actions
+    Action entry;
+    Action exit;
+  };
+
+  struct Transition {
+    StateId state;
+    Event::Type type;
+    Handler handler;
+  };
+
+  template <size_t NumTransitions>
+  constexpr HsmTable(const State (&states)[NumStates],
+      const Transition (&transitions)[NumTransitions], StateId initial)
+      : m_states(), m_handlers(), m_initial(initial) {
+    for (size_t s = 0; s < NumStates; s++) {
+      m_states[s] = states[s];
+    }
+
+    for (size_t t = 0; t < NumTransitions; t++) {
+      m_handlers[transitions[t].state][transitions[t].type] =
+          transitions[t].handler;
+    }
+
+    // inherit unhandled event types from the closest handling ancestor
+    for (size_t s = 0; s < NumStates; s++) {
+      for (size_t type = 0; type < Event::Type::kNumTypes; type++) {
+        StateId ancestor = m_states[s].parent;
+        while (m_handlers[s][type] == nullptr && ancestor != kNoState) {
+          m_handlers[s][type] = m_handlers[ancestor][type];
+          ancestor = m_states[ancestor].parent;
+        }
+      }
+    }
+  }
+
+  // @return Handler for the event type in the given state, nullptr if
+  //         neither the state nor any of its ancestors handle it
+  constexpr Handler handler(StateId state, Event::Type type) const {
+    return m_handlers[state][type];
+  }
+
+  constexpr const State& state(StateId id) const { return m_states[id]; }
+
+  constexpr StateId initial() const { return m_initial; }
+
+ private:
+  State m_states[NumStates];
+  Handler m_handlers[NumStates][Event::Type::kNumTypes];
+  StateId m_initial;
+};
+
+/**
+ * @brief Running instance of a hierarchical state machine
+ *
+ * Holds only the current state, all behavior comes from the (typically
+ * constexpr) HsmTable. dispatch() is meant to be called from a single consumer
+ * of an EventQueue, e.g. cal::ActiveObject::handle().
+ *
+ * On a transition, exit actions run from the current state up to (excluding)
+ * the closest common ancestor of the current and target states, then entry
+ * actions run down to the target and on through its initial substates.
+ * Transitions to an ancestor or descendant of the current state are local
+ * (the enclosing state isn't exited), transitioning to the current state
+ * exits and re-enters it.
+ */
+template <class Context, size_t NumStates>
+class Hsm {
+ public:
+  using Table = HsmTable<Context, NumStates>;
+  using StateId = typename Table::StateId;
+
+  Hsm(const Table& table, Context& ctx);
+
+  // @brief Enter the initial state (running its entry actions)
+  void start();
+
+  /**
+   * @brief Dispatch an event to the current state
+   * @return True if a handler ran, false if the event was unhandled
+   */
+  bool dispatch(Event& e);
+
+  // @return Current (leaf) state
+  StateId current() const;
+
+  // @return True if the current state is the given state or nested in it
+  bool isIn(StateId state) const;
+
+ private:
+  void transition(StateId target);
+
+  // @brief Run entry actions from (excluding) ancestor down to target, then
+  //        down through target's initial substates
+  void enter(StateId ancestor, StateId target);
+
+  const Table& m_table;
+  Context& m_ctx;
+  StateId m_current = Table::kNoState;
+};
+
+}
+
+#include "Hsm.inc"
@@ -0,0 +1,44 @@
+#include "LoadMeter.h"
+
+cal::LoadMeter::LoadMeter(uint32_t now) : m_windowStart(now) {}
+
+void cal::LoadMeter::idleEnter(uint32_t now) {
+  m_isIdle = true;
+  m_idleSince = now;
+}
+
+/**
+ * @note Time differences are computed with unsigned subtraction, so
+ *       timestamps are allowed to wrap (windows must be shorter than one
+ *       period of the clock)
+ */
+void cal::LoadMeter::idleLeave(uint32_t now) {
+  if (!m_isIdle) {
+    return;
+  }
+
+  m_isIdle = false;
+  m_idle += now - m_idleSince;
+  m_wakeups++;
+}
+
+cal::LoadMeter::Sample cal::LoadMeter::sample(uint32_t now) {
+  if (m_isIdle) {
+    m_idle += now - m_idleSince;
+    m_idleSince = now;
+  }
+
+  Sample s;
+  s.elapsed = now - m_windowStart;
+  s.idle = m_idle < s.elapsed ? m_idle : s.elapsed;
+  s.wakeups = m_wakeups;
+  s.loadPermille = s.elapsed == 0 ? 0 : static_cast<uint32_t>(
+      static_cast<uint64_t>(s.elapsed - s.idle) * 1000 / s.elapsed);
+
+  m_windowStart = now;
+  m_idle = 0;
+  m_wakeups = 0;
+  return s;
+}
+
+bool cal::LoadMeter::isIdle() const { return m_isIdle; }
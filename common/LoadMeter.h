@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace cal {
+
+/**
+ * @brief Busy/idle time accounting from idle enter/leave notifications
+ *
+ * Fed by the kernel's idle hooks, the meter accumulates the time spent idle
+ * and counts wakeups (idle leaves). Each sample() closes a window and
+ * reports the load, i.e. the share of the window that wasn't idle, and the
+ * wakeups within it. Converting polling loops to blocking waits should show
+ * up as both fewer wakeups and a lower load.
+ *
+ * @note This class has no ChibiOS dependencies, all timestamps are in
+ *       caller-defined units (e.g. cycles or system ticks), so it can be
+ *       driven by a simulated clock in unit tests and benchmarks
+ * @note Not thread-safe, callers must serialize all calls (e.g. by calling
+ *       them from within the kernel lock, as the idle hooks are)
+ */
+class LoadMeter {
+ public:
+  struct Sample {
+    // length of the window, and time spent idle within it
+    uint32_t elapsed;
+    uint32_t idle;
+
+    // idle leaves within the window
+    uint32_t wakeups;
+
+    // share of the window spent busy, in 1/1000
+    uint32_t loadPermille;
+  };
+
+  // @param now Time the first window starts
+  explicit LoadMeter(uint32_t now = 0);
+
+  // @brief The system went idle
+  void idleEnter(uint32_t now);
+
+  // @brief The system left idle to run something
+  void idleLeave(uint32_t now);
+
+  /**
+   * @brief Close the current window and start a new one
+   * @note A window that's still idle at now is split, the idle time up to
+   *       now counts towards the closed window
+   */
+  Sample sample(uint32_t now);
+
+  // @return True between idleEnter() and idleLeave()
+  bool isIdle() const;
+
+ private:
+  uint32_t m_windowStart;
+  uint32_t m_idleSince = 0;
+  uint32_t m_idle = 0;
+  uint32_t m_wakeups = 0;
+  bool m_isIdle = false;
+};
+
+}
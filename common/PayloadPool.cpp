@@ -0,0 +1,95 @@
+#include "PayloadPool.h"
+
+#include <stdint.h>
+
+#include <new>
+
+#include "Stats.h"
+#include "ch.h"
+
+cal::Payload::Payload(PayloadPoolBase& pool) : m_pool(pool) {}
+
+/**
+ * @note The data follows the header in the pool's Block layout
+ */
+uint8_t *cal::Payload::data() { return reinterpret_cast<uint8_t *>(this + 1); }
+
+const uint8_t *cal::Payload::data() const {
+  return reinterpret_cast<const uint8_t *>(this + 1);
+}
+
+size_t cal::Payload::size() const { return m_size; }
+
+void cal::Payload::setSize(size_t size) {
+  m_size = size < capacity() ? size : capacity();
+}
+
+size_t cal::Payload::capacity() const { return m_pool.blockSize(); }
+
+void cal::Payload::retain(uint16_t n) {
+  m_refs.fetch_add(n, std::memory_order_relaxed);
+}
+
+/**
+ * @note Release ordering makes every consumer's reads of the data happen
+ *       before the block is freed (and rewritten by its next producer)
+ */
+void cal::Payload::release() {
+  if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    m_pool.free(this);
+  }
+}
+
+uint16_t cal::Payload::refs() const {
+  return m_refs.load(std::memory_order_relaxed);
+}
+
+cal::PayloadPoolBase::PayloadPoolBase(size_t blockSize, size_t objectSize)
+    : m_blockSize(blockSize) {
+  // no provider, the pool only ever holds the blocks it's loaded with
+  chPoolObjectInit(&m_pool, objectSize, NULL);
+}
+
+void cal::PayloadPoolBase::load(void *objects, size_t count) {
+  chPoolLoadArray(&m_pool, objects, count);
+  m_available.store(count, std::memory_order_relaxed);
+}
+
+cal::Payload *cal::PayloadPoolBase::alloc() {
+  syssts_t sts = chSysGetStatusAndLockX();
+  void *block = chPoolAllocI(&m_pool);
+  chSysRestoreStatusX(sts);
+
+  if (block == nullptr) {
+    m_allocFailures.increment();
+    return nullptr;
+  }
+  m_available.fetch_sub(1, std::memory_order_relaxed);
+  return new (block) Payload(*this);
+}
+
+size_t cal::PayloadPoolBase::blockSize() const { return m_blockSize; }
+
+size_t cal::PayloadPoolBase::available() const {
+  return m_available.load(std::memory_order_relaxed);
+}
+
+uint32_t cal::PayloadPoolBase::allocFailures() const {
+  return m_allocFailures.value();
+}
+
+void cal::PayloadPoolBase::registerStats(const char *group) {
+  cal::Stats::add(group, "free", [] (void *arg) -> uint32_t {
+    return static_cast<PayloadPoolBase *>(arg)->available();
+  }, this);
+  cal::Stats::add(group, "allocFailures", m_allocFailures);
+}
+
+void cal::PayloadPoolBase::free(cal::Payload *payload) {
+  payload->~Payload();
+  m_available.fetch_add(1, std::memory_order_relaxed);
+
+  syssts_t sts = chSysGetStatusAndLockX();
+  chPoolFreeI(&m_pool, payload);
+  chSysRestoreStatusX(sts);
+}
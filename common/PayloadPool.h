@@ -0,0 +1,156 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <type_traits>
+
+#include "Stats.h"
+#include "ch.h"
+
+namespace cal {
+
+class PayloadPoolBase;
+
+/**
+ * @brief Reference-counted block of bytes from a cal::PayloadPool, for
+ *        messages that don't fit an Event's params
+ *
+ * A block starts with one reference, its producer's. Whoever a reference is
+ * handed to (e.g. a queue, by pushing an event carrying the block) owns it and
+ * must release() it exactly once, the last release returns the block to its
+ * pool. Fanning a block out to n consumers is retain(n - 1) plus n pointer
+ * copies, the bytes are written once and never copied.
+ *
+ * @note The data is only safe to write while the writer holds the only
+ *       reference, treat it as read-only once the block is shared
+ */
+class Payload {
+ public:
+  // blocks are referenced by address
+  Payload(const Payload&) = delete;
+  Payload& operator=(const Payload&) = delete;
+
+  uint8_t *data();
+  const uint8_t *data() const;
+
+  // @return Bytes of data in use, set by the producer
+  size_t size() const;
+
+  // @brief Set the bytes of data in use, at most capacity()
+  void setSize(size_t size);
+
+  // @return Bytes of data in the block
+  size_t capacity() const;
+
+  // @brief Add n references, callable from any context
+  void retain(uint16_t n = 1);
+
+  // @brief Drop a reference, freeing the block if it was the last one.
+  //        Callable from any context.
+  void release();
+
+  // @return Number of references held
+  uint16_t refs() const;
+
+ private:
+  friend class PayloadPoolBase;
+
+  explicit Payload(PayloadPoolBase& pool);
+
+  PayloadPoolBase& m_pool;
+  std::atomic<uint16_t> m_refs{1};
+  uint16_t m_size = 0;
+};
+
+/**
+ * @brief Size-independent part of cal::PayloadPool
+ */
+class PayloadPoolBase {
+ public:
+  // blocks refer back to their pool by address
+  PayloadPoolBase(const PayloadPoolBase&) = delete;
+  PayloadPoolBase& operator=(const PayloadPoolBase&) = delete;
+
+  /**
+   * @brief Take a block holding one reference, callable from any context
+   *        (e.g. a driver callback filling it)
+   * @return The block, nullptr if every block is in use
+   */
+  cal::Payload *alloc();
+
+  // @return Bytes of data in each block
+  size_t blockSize() const;
+
+  // @return Number of blocks currently free
+  size_t available() const;
+
+  // @return Number of alloc() calls that found no free block
+  uint32_t allocFailures() const;
+
+  /**
+   * @brief Register free blocks and failed allocations in cal::Stats
+   * @param group Name the pool's stats are listed under
+   */
+  void registerStats(const char *group);
+
+ protected:
+  PayloadPoolBase(size_t blockSize, size_t objectSize);
+
+  // @brief Hand count objects of the size given to the constructor to the
+  //        ChibiOS pool
+  void load(void *objects, size_t count);
+
+ private:
+  friend class Payload;
+
+  // @brief Return a block to the pool, callable from any context
+  void free(cal::Payload *payload);
+
+  size_t m_blockSize;
+  memory_pool_t m_pool;
+  std::atomic<uint32_t> m_available{0};
+  cal::Counter m_allocFailures;
+};
+
+/**
+ * @brief Pool of Count blocks of BlockSize bytes, backed by a ChibiOS memory
+ *        pool
+ *
+ * @code
+ *   static cal::PayloadPool<64, 8> frames;
+ *
+ *   cal::Payload *frame = frames.alloc();
+ *   if (frame != nullptr) {
+ *     frame->setSize(readFrame(frame->data(), frame->capacity()));
+ *     bus.publish(Event(Event::Type::kUartRx, frame));
+ *   }
+ * @endcode
+ *
+ * @note Like the ChibiOS pool it wraps, the blocks are a member, so a pool
+ *       should be given static storage duration
+ */
+template <size_t BlockSize, size_t Count>
+class PayloadPool : public PayloadPoolBase {
+ public:
+  static_assert(BlockSize > 0 && BlockSize <= 0xFFFF,
+      "cal::PayloadPool block sizes are 16 bit");
+  static_assert(Count > 0, "cal::PayloadPool needs at least one block");
+
+  PayloadPool();
+
+ private:
+  // a block's data follows its header
+  struct Block {
+    typename std::aligned_storage<sizeof(Payload), alignof(Payload)>::type
+        header;
+    uint8_t data[BlockSize];
+  };
+
+  Block m_blocks[Count];
+};
+
+}
+
+#include "PayloadPool.inc"
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "Delegate.h"
+
+namespace cal {
+
+// Max length of a std::printf message in bytes, longer ones are cut
+static constexpr size_t kMaxPrintfLen = 128;
+
+/**
+ * @brief Route std::printf (see StdLib.cpp) to sink, e.g. a cal::Uart's TX
+ *        ring with cal::Uart::routePrintf()
+ * @param sink Called with each formatted message, from the printing context.
+ *        Messages are dropped while no sink is set.
+ * @note Messages are formatted on the printing thread's stack
+ */
+void setPrintfSink(cal::Delegate<void(const char *, size_t)> sink);
+
+}
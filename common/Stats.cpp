@@ -0,0 +1,86 @@
+#include "Stats.h"
+
+#include <atomic>
+#include <cstring>
+
+#include "ch.h"
+
+// Definitions for static members
+constexpr size_t cal::Stats::kMaxStats;
+std::array<cal::Stats::Stat, cal::Stats::kMaxStats> cal::Stats::stats = {};
+size_t cal::Stats::count = 0;
+
+void cal::Counter::increment(uint32_t n) {
+  m_value.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint32_t cal::Counter::value() const {
+  return m_value.load(std::memory_order_relaxed);
+}
+
+void cal::Counter::reset() { m_value.store(0, std::memory_order_relaxed); }
+
+uint32_t cal::Stats::Stat::read() const {
+  return counter != nullptr ? counter->value() : gauge(arg);
+}
+
+bool cal::Stats::Stat::matches(const char *prefix) const {
+  size_t groupLen = std::strlen(group);
+  size_t prefixLen = std::strlen(prefix);
+
+  // within the group, or past it and within the name
+  if (prefixLen <= groupLen) {
+    return std::strncmp(group, prefix, prefixLen) == 0;
+  }
+  return std::strncmp(group, prefix, groupLen) == 0
+      && prefix[groupLen] == '.'
+      && std::strncmp(name, prefix + groupLen + 1,
+          prefixLen - groupLen - 1) == 0;
+}
+
+bool cal::Stats::add(const char *group, const char *name,
+    const cal::Counter& counter) {
+  return add(Stat{group, name, &counter, nullptr, nullptr});
+}
+
+bool cal::Stats::add(const char *group, const char *name, Gauge gauge,
+    void *arg) {
+  return add(Stat{group, name, nullptr, gauge, arg});
+}
+
+void cal::Stats::addAllocatorStats(const char *group) {
+  add(group, "heapFree", [] (void *) -> uint32_t {
+    size_t total = 0;
+    chHeapStatus(nullptr, &total, nullptr);
+    return total;
+  }, nullptr);
+  add(group, "heapFragments", [] (void *) -> uint32_t {
+    return chHeapStatus(nullptr, nullptr, nullptr);
+  }, nullptr);
+  add(group, "coreFree", [] (void *) -> uint32_t {
+    return chCoreGetStatusX();
+  }, nullptr);
+  add(group, "heapAllocations", [] (void *) -> uint32_t {
+    return cal::heapAllocations();
+  }, nullptr);
+}
+
+size_t cal::Stats::size() { return count; }
+
+const cal::Stats::Stat& cal::Stats::at(size_t i) { return stats[i]; }
+
+/**
+ * @note The entry is written before the count is bumped, so readers
+ *       iterating up to size() never see a partial entry
+ */
+bool cal::Stats::add(const Stat& stat) {
+  chSysLock();
+  bool added = count < kMaxStats;
+  if (added) {
+    stats[count] = stat;
+    count++;
+  }
+  chSysUnlock();
+
+  return added;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <array>
+#include <atomic>
+
+#include "ch.h"
+
+namespace cal {
+
+// @return Number of operator new calls so far (counted by StdLib.cpp), e.g. to
+//         check that a hot path never touches the heap
+uint32_t heapAllocations();
+
+/**
+ * @brief Event counter, cheap and safe to increment from any context
+ *
+ * Increments are a single relaxed atomic add (LDREX/STREX on Cortex-M), so
+ * ISRs and threads may count concurrently without locks and without losing
+ * counts.
+ */
+class Counter {
+ public:
+  Counter() = default;
+
+  // counters are registered in cal::Stats by address
+  Counter(const Counter&) = delete;
+  Counter& operator=(const Counter&) = delete;
+
+  void increment(uint32_t n = 1);
+
+  uint32_t value() const;
+
+  void reset();
+
+ private:
+  std::atomic<uint32_t> m_value{0};
+};
+
+/**
+ * @brief Registry of named runtime statistics, for live introspection (e.g.
+ *        with cal::StatsShell)
+ *
+ * Subsystems register their counters, and gauges that are sampled when read
+ * (e.g. a queue's depth), under a group name given by the application. Stats
+ * are listed as "group.name".
+ *
+ * Like cal::KernelProfiler, the registry is static and global, and entries
+ * can't be removed, so only register objects that live for the rest of the
+ * program.
+ *
+ * @note Group and stat names aren't copied, pass string literals
+ */
+class Stats {
+ public:
+  // Max number of registered stats, further registrations fail
+  static constexpr size_t kMaxStats = 48;
+
+  // @brief Sample a gauge, arg is the pointer it was registered with
+  using Gauge = uint32_t (*)(void *arg);
+
+  struct Stat {
+    const char *group;
+    const char *name;
+
+    // either a counter, or a gauge and its arg
+    const cal::Counter *counter;
+    Gauge gauge;
+    void *arg;
+
+    // @return Current value of the stat
+    uint32_t read() const;
+
+    // @return True if the stat's full name starts with prefix
+    bool matches(const char *prefix) const;
+  };
+
+  // @return False if the registry is full
+  static bool add(const char *group, const char *name,
+      const cal::Counter& counter);
+  static bool add(const char *group, const char *name, Gauge gauge,
+      void *arg);
+
+  /**
+   * @brief Register the heap's and core allocator's free memory, i.e. what's
+   *        left for operator new (see StdLib.cpp), and the number of
+   *        allocations so far
+   */
+  static void addAllocatorStats(const char *group);
+
+  // @return Number of registered stats
+  static size_t size();
+
+  // @return The i-th registered stat, in registration order
+  static const Stat& at(size_t i);
+
+ private:
+  static bool add(const Stat& stat);
+
+  static std::array<Stat, kMaxStats> stats;
+  static size_t count;
+};
+
+}
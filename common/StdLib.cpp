@@ -1,9 +1,15 @@
 #include "StdLib.h"
 #include "hal.h"  // NOLINT
 
+#include <stdint.h>
+
+#include <atomic>
 #include <cstdarg>
 #include <cstdlib>
 
+#include "Delegate.h"
+#include "Printf.h"
+#include "Stats.h"
 #include "ch.h"
 #include "chprintf.h"
 
@@ -26,12 +32,23 @@
 //}
 //}
 
-void* operator new(size_t size) { return chHeapAllocAligned(nullptr, size, 1); }
+// every operator new call, relaxed since it's only ever read as a total
+static std::atomic<uint32_t> heapAllocationCount{0};
+
+void* operator new(size_t size) {
+  heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
+  return chHeapAllocAligned(nullptr, size, 1);
+}
 
 void* operator new[](size_t size) {
+  heapAllocationCount.fetch_add(1, std::memory_order_relaxed);
   return chHeapAllocAligned(nullptr, size, 1);
 }
 
+uint32_t cal::heapAllocations() {
+  return heapAllocationCount.load(std::memory_order_relaxed);
+}
+
 void operator delete(void* ptr) { chHeapFree(ptr); }
 
 void operator delete(void* ptr, size_t size) {
@@ -54,27 +71,36 @@ void operator delete[](void* ptr, size_t size) {
 
 // void __cxa_pure_virtual(void) {};
 
-#if (HAL_USE_SERIAL == TRUE)
+// where std::printf output goes, set before printing
+static cal::Delegate<void(const char *, size_t)> printfSink;
 
+void cal::setPrintfSink(cal::Delegate<void(const char *, size_t)> sink) {
+  syssts_t sts = chSysGetStatusAndLockX();
+  printfSink = sink;
+  chSysRestoreStatusX(sts);
+}
+
+/**
+ * @note Formatted into a buffer first, so the sink gets whole messages instead
+ *       of the character at a time chvprintf writes to a stream
+ */
 namespace std {
 int printf(const char* format, ...) {
-  static BaseSequentialStream* chp =
-      reinterpret_cast<BaseSequentialStream*>(&SD1);
-  static bool init = false;
-  if (!init) {
-    // Activate serial driver 1 using the default driver configuration
-    sdStart(&SD1, nullptr);
-    init = true;
-  }
+  char buffer[cal::kMaxPrintfLen + 1];
 
-  int size = 0;
   va_list ap;
-
   va_start(ap, format);
-  size = chvprintf(chp, format, ap);
+  int size = chvsnprintf(buffer, sizeof(buffer), format, ap);
   va_end(ap);
 
+  syssts_t sts = chSysGetStatusAndLockX();
+  cal::Delegate<void(const char *, size_t)> sink = printfSink;
+  chSysRestoreStatusX(sts);
+
+  if (size > 0 && sink) {
+    size_t len = static_cast<size_t>(size);
+    sink(buffer, len < cal::kMaxPrintfLen ? len : cal::kMaxPrintfLen);
+  }
   return size;
 }
 }  // namespace std
-#endif
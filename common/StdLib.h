@@ -22,6 +22,7 @@ extern "C" void __cxa_pure_virtual(void);
 #ifdef __cplusplus
 namespace std {
 #endif  // __cplusplus
+// formats into the sink set with cal::setPrintfSink() (see Printf.h)
 int printf(const char* format, ...);
 #ifdef __cplusplus
 }  // std
@@ -0,0 +1,31 @@
+#include "Task.h"
+
+cal::Task::Status cal::Task::resume(uint32_t now) {
+  if (m_done) {
+    return Status::kDone;
+  }
+
+  m_now = now;
+  if (run() == Status::kDone) {
+    m_done = true;
+    m_sleeping = false;
+    return Status::kDone;
+  }
+  return Status::kWaiting;
+}
+
+bool cal::Task::done() const { return m_done; }
+
+bool cal::Task::deadline(uint32_t& when) const {
+  if (!m_sleeping) {
+    return false;
+  }
+  when = m_wakeAt;
+  return true;
+}
+
+void cal::Task::restart() {
+  m_resumeLine = 0;
+  m_sleeping = false;
+  m_done = false;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace cal {
+
+/**
+ * @brief Stackless cooperative task (protothread)
+ *
+ * Derived classes implement run() as a sequence of steps between awaits,
+ * using the CAL_TASK_* macros below. Awaiting returns from run() and records
+ * where to continue, so the next resume() jumps straight back to the await and
+ * re-checks its condition. A task costs its own members plus a few words,
+ * rather than a thread's working area, and any number of tasks can share one
+ * thread (see cal::TaskScheduler).
+ *
+ * @code
+ *   Status run() override {
+ *     CAL_TASK_BEGIN();
+ *     while (true) {
+ *       CAL_TASK_AWAIT_EVENT(m_queue, m_event);
+ *       m_ticket = m_uart.sendAsync(m_buffer, format(m_event));
+ *       CAL_TASK_AWAIT(m_uart.txDone(m_ticket));
+ *       CAL_TASK_SLEEP(MS2ST(10));
+ *     }
+ *     CAL_TASK_END();
+ *   }
+ * @endcode
+ *
+ * @note This is the macro fallback for toolchains without C++20 coroutines
+ *       (the targets build with -std=c++1z): run() is a switch on the resume
+ *       point. Locals don't survive an await, keep state in members. Only
+ *       one await per source line, since lines number the resume points, and
+ *       no awaits inside a switch statement of run() itself.
+ * @note This class has no ChibiOS dependencies, time is in caller-defined
+ *       ticks passed to resume(), so tasks can be driven from a simulated
+ *       clock in unit tests and benchmarks
+ */
+class Task {
+ public:
+  enum class Status : uint8_t {
+    // suspended at an await, resume() again once its condition may hold
+    kWaiting,
+    // run() returned from CAL_TASK_END()
+    kDone
+  };
+
+  // schedulers link tasks through them
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+
+  virtual ~Task() = default;
+
+  /**
+   * @brief Run the task from where it last awaited until it awaits again or
+   *        finishes. Finished tasks stay done until restart().
+   * @param now Current time in ticks, for CAL_TASK_SLEEP()
+   */
+  Status resume(uint32_t now);
+
+  // @return True once run() reached CAL_TASK_END()
+  bool done() const;
+
+  /**
+   * @brief Tick the task is sleeping until, so a scheduler knows when to
+   *        resume it without being woken
+   * @return False if the task isn't in CAL_TASK_SLEEP()
+   */
+  bool deadline(uint32_t& when) const;
+
+  // @brief Start over from the top of run() on the next resume()
+  void restart();
+
+ protected:
+  Task() = default;
+
+  /**
+   * @brief Task body, between CAL_TASK_BEGIN() and CAL_TASK_END()
+   * @return kWaiting from an await, kDone from CAL_TASK_END()
+   */
+  virtual Status run() = 0;
+
+  // state of the CAL_TASK_* macros, use them rather than these directly
+
+  // line of the await to continue from, 0 for the top of run()
+  uint16_t m_resumeLine = 0;
+  bool m_sleeping = false;
+  bool m_done = false;
+  uint32_t m_wakeAt = 0;
+
+  // time passed to the ongoing resume()
+  uint32_t m_now = 0;
+
+ private:
+  // intrusive list of a scheduler's tasks
+  friend class TaskSchedulerBase;
+  Task *m_next = nullptr;
+};
+
+}
+
+// @brief Open the body of cal::Task::run()
+#define CAL_TASK_BEGIN() switch (m_resumeLine) { case 0:
+
+/**
+ * @brief Suspend the task until condition holds. Checked immediately, then
+ *        again on every resume().
+ */
+#define CAL_TASK_AWAIT(condition)                                             \
+  do {                                                                        \
+    m_resumeLine = __LINE__;                                                  \
+    /* falls through */                                                       \
+    case __LINE__:                                                            \
+    if (!(condition)) {                                                       \
+      return cal::Task::Status::kWaiting;                                     \
+    }                                                                         \
+  } while (0)
+
+// @brief Let other tasks run, continuing on the next resume()
+#define CAL_TASK_YIELD()                                                      \
+  do {                                                                        \
+    m_sleeping = true;                                                        \
+    m_wakeAt = m_now;                                                         \
+    m_resumeLine = __LINE__;                                                  \
+    return cal::Task::Status::kWaiting;                                       \
+    case __LINE__:                                                            \
+    m_sleeping = false;                                                       \
+  } while (0)
+
+// @brief Suspend the task for at least ticks
+#define CAL_TASK_SLEEP(ticks)                                                 \
+  do {                                                                        \
+    m_wakeAt = m_now + static_cast<uint32_t>(ticks);                          \
+    m_sleeping = true;                                                        \
+    m_resumeLine = __LINE__;                                                  \
+    /* falls through */                                                       \
+    case __LINE__:                                                            \
+    if (static_cast<int32_t>(m_now - m_wakeAt) < 0) {                         \
+      return cal::Task::Status::kWaiting;                                     \
+    }                                                                         \
+    m_sleeping = false;                                                       \
+  } while (0)
+
+// @brief Suspend the task until queue is non-empty, then pop its next event
+//        into e (a member)
+#define CAL_TASK_AWAIT_EVENT(queue, e)                                        \
+  do {                                                                        \
+    CAL_TASK_AWAIT((queue).tryPop(e));                                        \
+  } while (0)
+
+// @brief Close the body of cal::Task::run(), finishing the task
+#define CAL_TASK_END()                                                        \
+  }                                                                           \
+  return cal::Task::Status::kDone
@@ -0,0 +1,280 @@
+#include "TimerWheel.h"
+
+#include <stdint.h>
+
+// Definitions for static members
+constexpr cal::TimerWheelBase::TimerId cal::TimerWheelBase::kInvalidTimer;
+constexpr size_t cal::TimerWheelBase::kLevels;
+constexpr size_t cal::TimerWheelBase::kSlotBits;
+constexpr size_t cal::TimerWheelBase::kSlots;
+constexpr uint32_t cal::TimerWheelBase::kRange;
+constexpr uint16_t cal::TimerWheelBase::kNil;
+constexpr uint16_t cal::TimerWheelBase::kExpiredList;
+constexpr uint16_t cal::TimerWheelBase::kNoList;
+
+// @return x rotated right by n bits (n < 64)
+static uint64_t rotateRight(uint64_t x, size_t n) {
+  return n == 0 ? x : (x >> n) | (x << (64 - n));
+}
+
+void cal::TimerWheelBase::init(Node *nodes, size_t capacity) {
+  m_nodes = nodes;
+  m_capacity = capacity;
+  m_heads.fill(kNil);
+  m_expiredTail = kNil;
+  m_occupied.fill(0);
+
+  for (size_t i = 0; i < m_capacity; i++) {
+    m_nodes[i].next = i + 1 < m_capacity ? static_cast<uint16_t>(i + 1) : kNil;
+    m_nodes[i].prev = kNil;
+    m_nodes[i].list = kNoList;
+    m_nodes[i].generation = 0;
+  }
+  m_free = 0;
+  m_active = 0;
+  m_now = 0;
+}
+
+cal::TimerWheelBase::TimerId cal::TimerWheelBase::start(uint32_t expiry,
+    uint32_t period) {
+  if (m_free == kNil) {
+    return kInvalidTimer;
+  }
+
+  uint16_t i = m_free;
+  Node& n = m_nodes[i];
+  m_free = n.next;
+
+  n.expiry = expiry;
+  n.period = period;
+  insert(i);
+  m_active++;
+
+  return (static_cast<TimerId>(n.generation) << 16) | i;
+}
+
+bool cal::TimerWheelBase::cancel(TimerId id) {
+  size_t i = index(id);
+  if (id == kInvalidTimer || i >= m_capacity) {
+    return false;
+  }
+
+  Node& n = m_nodes[i];
+  if (n.list == kNoList || n.generation != (id >> 16)) {
+    return false;
+  }
+
+  unlink(i);
+  release(i);
+  return true;
+}
+
+/**
+ * @note Jumps straight to the next tick with work to do, empty ticks in
+ *       between are skipped
+ */
+void cal::TimerWheelBase::advance(uint32_t now) {
+  while (m_now != now) {
+    uint32_t next;
+    if (!nextEvent(next) || next - m_now > now - m_now) {
+      m_now = now;
+      return;
+    }
+
+    m_now = next;
+    processTick();
+  }
+}
+
+/**
+ * @note Slots of level l are processed at multiples of kSlots^l ticks, the
+ *       next occupied one is found by rotating the level's bitmap so the slot
+ *       after the current one is bit 0
+ */
+bool cal::TimerWheelBase::nextEvent(uint32_t& when) const {
+  bool found = false;
+  uint32_t bestDistance = 0;
+
+  for (size_t level = 0; level < kLevels; level++) {
+    if (m_occupied[level] == 0) {
+      continue;
+    }
+
+    size_t shift = kSlotBits * level;
+    uint32_t base = (m_now >> shift) + 1;
+    uint64_t rotated = rotateRight(m_occupied[level], base & (kSlots - 1));
+    uint32_t t = (base + __builtin_ctzll(rotated)) << shift;
+
+    if (!found || t - m_now < bestDistance) {
+      found = true;
+      bestDistance = t - m_now;
+      when = t;
+    }
+  }
+
+  return found;
+}
+
+cal::TimerWheelBase::TimerId cal::TimerWheelBase::popExpired(
+    uint16_t& overruns) {
+  overruns = 0;
+
+  uint16_t i = m_heads[kExpiredList];
+  if (i == kNil) {
+    return kInvalidTimer;
+  }
+
+  unlink(i);
+  Node& n = m_nodes[i];
+  TimerId id = (static_cast<TimerId>(n.generation) << 16) | i;
+
+  if (n.period == 0) {
+    release(i);
+    return id;
+  }
+
+  // the next expiry stays on the original schedule, periods that are already
+  // over are skipped and counted
+  uint32_t next = n.expiry + n.period;
+  if (static_cast<int32_t>(next - m_now) <= 0) {
+    uint32_t missed = (m_now - next) / n.period + 1;
+    next += missed * n.period;
+    overruns = missed > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(missed);
+  }
+  n.expiry = next;
+  insert(i);
+
+  return id;
+}
+
+uint32_t cal::TimerWheelBase::now() const { return m_now; }
+
+size_t cal::TimerWheelBase::active() const { return m_active; }
+
+size_t cal::TimerWheelBase::index(TimerId id) { return id & 0xFFFF; }
+
+/**
+ * @note Timers are placed by their distance from now: within kSlots ticks on
+ *       level 0, within kSlots^2 on level 1 and so on, in the slot their
+ *       expiry falls into. That slot is always ahead of the level's current
+ *       one, so it's processed before (or exactly at) the expiry.
+ */
+void cal::TimerWheelBase::insert(uint16_t i) {
+  Node& n = m_nodes[i];
+  uint32_t delta = n.expiry - m_now;
+
+  // due now or already past
+  if (delta == 0 || delta >= 0x80000000u) {
+    link(i, kExpiredList);
+    return;
+  }
+
+  // park timers beyond the wheel's range in its last slot
+  uint32_t placement = n.expiry;
+  if (delta >= kRange) {
+    delta = kRange - 1;
+    placement = m_now + delta;
+  }
+
+  size_t level = 0;
+  while (level + 1 < kLevels && delta >= (1u << (kSlotBits * (level + 1)))) {
+    level++;
+  }
+  size_t slot = (placement >> (kSlotBits * level)) & (kSlots - 1);
+
+  link(i, static_cast<uint16_t>(level * kSlots + slot));
+}
+
+void cal::TimerWheelBase::processTick() {
+  // cascade lower levels first, a higher level may refill their slots
+  for (size_t level = 1; level < kLevels; level++) {
+    size_t shift = kSlotBits * level;
+    if ((m_now & ((1u << shift) - 1)) != 0) {
+      break;
+    }
+    cascade(level, (m_now >> shift) & (kSlots - 1));
+  }
+
+  uint16_t list = m_now & (kSlots - 1);
+  while (m_heads[list] != kNil) {
+    uint16_t i = m_heads[list];
+    unlink(i);
+    link(i, kExpiredList);
+  }
+}
+
+void cal::TimerWheelBase::cascade(size_t level, size_t slot) {
+  uint16_t list = static_cast<uint16_t>(level * kSlots + slot);
+  uint16_t i = m_heads[list];
+
+  m_heads[list] = kNil;
+  m_occupied[level] &= ~(1ull << slot);
+
+  while (i != kNil) {
+    uint16_t next = m_nodes[i].next;
+    m_nodes[i].list = kNoList;
+    insert(i);
+    i = next;
+  }
+}
+
+/**
+ * @note Slots are LIFO, the expired list is FIFO so timers pop in the order
+ *       they expired
+ */
+void cal::TimerWheelBase::link(uint16_t i, uint16_t list) {
+  Node& n = m_nodes[i];
+  n.list = list;
+
+  if (list == kExpiredList) {
+    n.next = kNil;
+    n.prev = m_expiredTail;
+    if (m_expiredTail != kNil) {
+      m_nodes[m_expiredTail].next = i;
+    } else {
+      m_heads[list] = i;
+    }
+    m_expiredTail = i;
+    return;
+  }
+
+  n.prev = kNil;
+  n.next = m_heads[list];
+  if (n.next != kNil) {
+    m_nodes[n.next].prev = i;
+  }
+  m_heads[list] = i;
+  m_occupied[list / kSlots] |= 1ull << (list % kSlots);
+}
+
+void cal::TimerWheelBase::unlink(uint16_t i) {
+  Node& n = m_nodes[i];
+
+  if (n.prev != kNil) {
+    m_nodes[n.prev].next = n.next;
+  } else {
+    m_heads[n.list] = n.next;
+  }
+
+  if (n.next != kNil) {
+    m_nodes[n.next].prev = n.prev;
+  } else if (n.list == kExpiredList) {
+    m_expiredTail = n.prev;
+  }
+
+  if (n.list != kExpiredList && m_heads[n.list] == kNil) {
+    m_occupied[n.list / kSlots] &= ~(1ull << (n.list % kSlots));
+  }
+
+  n.list = kNoList;
+}
+
+void cal::TimerWheelBase::release(uint16_t i) {
+  Node& n = m_nodes[i];
+
+  n.list = kNoList;
+  n.generation++;
+  n.next = m_free;
+  m_free = i;
+  m_active--;
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <array>
+
+namespace cal {
+
+/**
+ * @brief Size-independent part of cal::TimerWheel
+ *
+ * A hierarchical timing wheel: kLevels wheels of kSlots slots each, where a
+ * slot of level l spans kSlots^l ticks. Timers are kept in intrusive lists,
+ * in the level-0 slot of their expiry tick if they expire within kSlots
+ * ticks, otherwise in the higher level slot covering their expiry. When time
+ * reaches the start of a higher level slot, its timers cascade down a level.
+ * Starting and canceling a timer is O(1), and so is expiring it (amortized
+ * over at most kLevels cascades).
+ *
+ * Occupancy bitmaps per level make nextEvent() and advance() skip empty
+ * slots, so time may jump by any amount (e.g. to the deadline a tickless
+ * kernel timer was armed with) without touching every tick in between.
+ *
+ * Expired timers are moved to an expired list in expiry order, and picked up
+ * one at a time with popExpired(), which also re-arms periodic timers. This
+ * lets callers hold a lock only for short, bounded steps.
+ *
+ * @note This class has no ChibiOS dependencies, time is in caller-defined
+ *       ticks (e.g. system ticks), so it can be driven from a simulated clock
+ *       in unit tests and benchmarks
+ * @note Time wraps, delays must be less than half the tick range. Timers
+ *       further out than the wheel's range (kSlots^kLevels ticks) are parked
+ *       in the last slot in range and cascade until they're due.
+ * @note Not thread-safe, callers must serialize all calls
+ */
+class TimerWheelBase {
+ public:
+  // Index of the timer's node in the low half, generation in the high half,
+  // so IDs of timers that were freed and reused don't alias
+  using TimerId = uint32_t;
+
+  static constexpr TimerId kInvalidTimer = 0xFFFFFFFF;
+
+  static constexpr size_t kLevels = 4;
+  static constexpr size_t kSlotBits = 6;
+  static constexpr size_t kSlots = 1 << kSlotBits;
+
+  // Ticks covered by the wheel, later expiries are parked
+  static constexpr uint32_t kRange = 1u << (kSlotBits * kLevels);
+
+  struct Node {
+    uint32_t expiry;
+
+    // 0 for one-shot timers
+    uint32_t period;
+
+    uint16_t next;
+    uint16_t prev;
+
+    // list the node is linked in (a slot, the expired list or none)
+    uint16_t list;
+
+    uint16_t generation;
+  };
+
+  TimerWheelBase(const TimerWheelBase&) = delete;
+  TimerWheelBase& operator=(const TimerWheelBase&) = delete;
+
+  /**
+   * @brief Start a timer
+   * @param expiry Tick the timer first expires at, timers that are already
+   *        due expire on the next popExpired()
+   * @param period Ticks between expiries of a periodic timer, 0 for one-shot
+   * @return The timer's ID, kInvalidTimer if every timer is in use
+   */
+  TimerId start(uint32_t expiry, uint32_t period);
+
+  /**
+   * @brief Stop a timer, including one that expired but wasn't popped yet
+   * @return False if the timer wasn't running (e.g. a one-shot timer that
+   *         was already popped)
+   */
+  bool cancel(TimerId id);
+
+  // @brief Advance time to now, moving timers that expire by then to the
+  //        expired list
+  void advance(uint32_t now);
+
+  /**
+   * @brief Tick at which advance() next has work to do, i.e. a timer expires
+   *        or a higher level slot cascades. A tickless timer armed for this
+   *        tick keeps the wheel on time.
+   * @return False if no timers are waiting in the wheel (there may still be
+   *         expired ones to pop)
+   */
+  bool nextEvent(uint32_t& when) const;
+
+  /**
+   * @brief Take the next expired timer, re-arming it if it's periodic.
+   *        One-shot timers are freed.
+   * @param overruns Set to the number of periods a periodic timer missed
+   *        because it was popped late
+   * @return ID of the expired timer, kInvalidTimer if none expired
+   */
+  TimerId popExpired(uint16_t& overruns);
+
+  // @return Tick the wheel has advanced to
+  uint32_t now() const;
+
+  // @return Number of running timers
+  size_t active() const;
+
+  // @return Index of a timer's node, in [0, capacity)
+  static size_t index(TimerId id);
+
+ protected:
+  TimerWheelBase() = default;
+
+  // @brief Take over storage for capacity nodes, freeing every node and
+  //        rewinding time to 0
+  void init(Node *nodes, size_t capacity);
+
+ private:
+  static constexpr uint16_t kNil = 0xFFFF;
+  static constexpr uint16_t kExpiredList = kLevels * kSlots;
+  static constexpr uint16_t kNoList = kExpiredList + 1;
+
+  // @brief Link a node into the list matching its expiry
+  void insert(uint16_t i);
+
+  // @brief Process tick m_now, cascading and expiring its slots
+  void processTick();
+
+  // @brief Re-insert every node of a higher level slot
+  void cascade(size_t level, size_t slot);
+
+  void link(uint16_t i, uint16_t list);
+  void unlink(uint16_t i);
+
+  // @brief Return a node to the free list, invalidating its ID
+  void release(uint16_t i);
+
+  Node *m_nodes = nullptr;
+  size_t m_capacity = 0;
+
+  std::array<uint16_t, kLevels * kSlots + 1> m_heads;
+  uint16_t m_expiredTail = kNil;
+  std::array<uint64_t, kLevels> m_occupied;
+
+  uint16_t m_free = kNil;
+  size_t m_active = 0;
+  uint32_t m_now = 0;
+};
+
+/**
+ * @brief Timing wheel with storage for Capacity timers
+ */
+template <size_t Capacity>
+class TimerWheel : public TimerWheelBase {
+ public:
+  static_assert(Capacity > 0 && Capacity < 0xFFFF,
+      "cal::TimerWheel node indices are 16 bit");
+
+  TimerWheel();
+
+ private:
+  std::array<Node, Capacity> m_storage;
+};
+
+}
+
+#include "TimerWheel.inc"
@@ -0,0 +1,86 @@
+#include <array>
+#include <mutex>
+#include <string>
+#include <cstring>
+#include <utest/utest.hpp>
+#include <utest/test_reporter/google_test.hpp>
+
+// library common includes
+#include "cal.h"
+#include "common/Clock.h"
+// UART TestWriter adapter (the UART only reports results for these tests)
+#include "UartWriter.h"
+#include "Uart.h"
+
+// chibios and target-specific includes
+#include "ch.hpp"
+#include "hal.h"
+#include "pinconf.h"
+
+// defined tests and benchmarks, included here just to keep main short
+#include "tests.cpp"
+#include "benchmarks.cpp"
+
+int main() {
+  /*
+   * System initializations.
+   * - HAL initialization, this also initializes the configured device drivers
+   *   and performs the board-specific initializations.
+   * - Kernel initialization, the main() function becomes a thread and the
+   *   RTOS is active.
+   */
+  halInit();
+  chSysInit();
+
+  // timestamps for events
+  cal::Clock::start();
+
+  // Pin initialization
+
+  // TODO: Change to #def'd vars and move to UART subsystem
+  // USART3_TX, PAL_MODE_OUTPUT_PUSHPULL
+  palSetPadMode(GPIOC, 10, PAL_MODE_ALTERNATE(7));
+  // USART3_RX, PAL_MODE_OUTPUT_PUSHPULL
+  palSetPadMode(GPIOC, 11, PAL_MODE_ALTERNATE(7));
+
+  // Digital outputs
+  palSetPadMode(STARTUP_LED_PORT, STARTUP_LED_PIN,
+                PAL_MODE_OUTPUT_PUSHPULL);
+
+  // Init LED states to LOW
+  palClearPad(STARTUP_LED_PORT, STARTUP_LED_PIN);
+
+  cal::CriticalSectionEventQueue uartEventQueue;
+
+  // setup a UART interface to report test results over
+  cal::Uart uart(UartInterface::kD3, uartEventQueue);
+
+  testUart = &uart;
+  UartWriter writer(&uart);
+
+  utest::TestWriterReference writers[]{
+    writer
+  };
+
+  utest::test_reporter::GoogleTest google_test{writers};
+
+  utest::TestReporterReference reporters[]{
+    google_test
+  };
+
+  if (utest::TestStatus::PASS == utest::Test(reporters).run().status()) {
+    uart.send("\r\nAll tests PASSED\r\n");
+  } else {
+    uart.send("\r\nTests FAILED\r\n");
+  }
+
+  // drain the test output so it doesn't compete with the benchmarks
+  writer.flush();
+
+  runBenchmarks(uart);
+
+  // sleep forever
+  while (1) {
+    chThdSleepMilliseconds(1000);
+  }
+}
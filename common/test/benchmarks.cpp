@@ -0,0 +1,649 @@
+#include <stdint.h>
+
+#include <algorithm>
+#include <array>
+#include <functional>
+
+#include "../Channel.h"
+#include "../Delegate.h"
+#include "../DriverCallback.h"
+#include "../Event.h"
+#include "../EventBus.h"
+#include "../EventQueue.h"
+#include "../Histogram.h"
+#include "../Hsm.h"
+#include "../LoadMeter.h"
+#include "../Stats.h"
+#include "../Task.h"
+#include "../TimerWheel.h"
+#include "Uart.h"
+#include "ch.h"
+#include "hal.h"
+
+/**
+ * @note Benchmarks time a loop of iterations with the realtime (cycle)
+ *       counter and report the average cost per iteration over UART. They
+ *       aren't pass/fail, so they run after the uTest suites.
+ */
+static constexpr uint32_t kBenchIterations = 1000;
+
+static void reportBenchmark(cal::Uart& uart, const char *name,
+    rtcnt_t totalCycles, uint32_t iterations) {
+  uart.send("[ BENCH    ] ");
+  uart.send(name);
+  uart.send(": ");
+  uart.send(static_cast<int>(totalCycles / iterations));
+  uart.send(" cycles/op\r\n");
+  // let the TX queue drain between reports
+  chThdSleepMilliseconds(10);
+}
+
+/**
+ * @brief Cost of publishing one event to 1..kMaxSubscribers queues, versus
+ *        pushing it to a single queue directly
+ */
+static void benchEventBusFanOut(cal::Uart& uart) {
+  static cal::MutexEventQueue queues[cal::EventBus::kMaxSubscribers];
+  static const char *names[] = {
+    "EventBus publish, 1 subscriber", "EventBus publish, 2 subscribers",
+    "EventBus publish, 3 subscribers", "EventBus publish, 4 subscribers"
+  };
+  static_assert(sizeof(names) / sizeof(names[0])
+      == cal::EventBus::kMaxSubscribers, "one name per fan-out");
+
+  Event e(Event::Type::kUartRx, 'b');
+
+  rtcnt_t start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    queues[0].push(e);
+    queues[0].pop();
+  }
+  reportBenchmark(uart, "EventQueue push+pop (baseline)",
+      chSysGetRealtimeCounterX() - start, kBenchIterations);
+
+  cal::EventBus bus;
+  for (size_t subscribers = 0; subscribers < cal::EventBus::kMaxSubscribers;
+      subscribers++) {
+    bus.subscribe(Event::Type::kUartRx, queues[subscribers]);
+
+    start = chSysGetRealtimeCounterX();
+    for (uint32_t i = 0; i < kBenchIterations; i++) {
+      bus.publish(e);
+      for (size_t q = 0; q <= subscribers; q++) {
+        queues[q].pop();
+      }
+    }
+    reportBenchmark(uart, names[subscribers],
+        chSysGetRealtimeCounterX() - start, kBenchIterations);
+  }
+}
+
+// 50-state machine: a root, 7 composite states and 42 leaves spread across
+// them, every leaf moves to the next one on kUartRx
+static constexpr size_t kBenchHsmStates = 50;
+static constexpr size_t kBenchHsmComposites = 7;
+using BenchHsmTable = cal::HsmTable<uint32_t, kBenchHsmStates>;
+using BenchStateId = BenchHsmTable::StateId;
+
+static BenchStateId benchNextLeaf(uint32_t& ctx, Event& e) {
+  static_cast<void>(e);
+  ctx++;
+  return static_cast<BenchStateId>(kBenchHsmComposites + 1
+      + ctx % (kBenchHsmStates - kBenchHsmComposites - 1));
+}
+
+static BenchStateId benchStay(uint32_t& ctx, Event& e) {
+  static_cast<void>(e);
+  ctx++;
+  return BenchHsmTable::kNoState;
+}
+
+static void benchCount(uint32_t& ctx) { ctx++; }
+
+struct BenchHsmDescription {
+  BenchHsmTable::State states[kBenchHsmStates];
+  BenchHsmTable::Transition transitions[kBenchHsmStates + 1];
+};
+
+static constexpr BenchHsmDescription benchHsmDescription() {
+  BenchHsmDescription d = {};
+  for (size_t s = 0; s < kBenchHsmStates; s++) {
+    bool composite = s > 0 && s <= kBenchHsmComposites;
+    bool leaf = s > kBenchHsmComposites;
+    d.states[s] = {
+      s == 0 ? BenchHsmTable::kNoState
+          : composite ? static_cast<BenchStateId>(0)
+          : static_cast<BenchStateId>(1 + s % kBenchHsmComposites),
+      // initial substates: root -> first composite -> its first leaf
+      s == 0 ? static_cast<BenchStateId>(1)
+          : composite ? static_cast<BenchStateId>(kBenchHsmComposites + 1
+              + (s + kBenchHsmComposites - 2) % kBenchHsmComposites)
+          : BenchHsmTable::kNoState,
+      &benchCount, &benchCount
+    };
+    // leaves handle kUartRx themselves, everything else is unhandled here
+    d.transitions[s] = {static_cast<BenchStateId>(s),
+        leaf ? Event::Type::kUartRx : Event::Type::kNone,
+        leaf ? &benchNextLeaf : nullptr};
+  }
+  // inherited by all 50 states
+  d.transitions[kBenchHsmStates] = {0, Event::Type::kTimerTimeout,
+      &benchStay};
+  return d;
+}
+
+static constexpr BenchHsmDescription kBenchHsmDescription =
+    benchHsmDescription();
+static constexpr BenchHsmTable kBenchHsmTable(kBenchHsmDescription.states,
+    kBenchHsmDescription.transitions, 0);
+
+/**
+ * @brief Cost per dispatched event in a 50-state machine, for an inherited
+ *        handler that stays put (pure table lookup) and for a handler that
+ *        transitions between leaves of different composite states
+ */
+static void benchHsmDispatch(cal::Uart& uart) {
+  uint32_t ctx = 0;
+  cal::Hsm<uint32_t, kBenchHsmStates> hsm(kBenchHsmTable, ctx);
+  Event timeout(Event::Type::kTimerTimeout, 't');
+  Event rx(Event::Type::kUartRx, 'r');
+
+  hsm.start();
+
+  rtcnt_t start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    hsm.dispatch(timeout);
+  }
+  reportBenchmark(uart, "Hsm dispatch, 50 states, inherited handler",
+      chSysGetRealtimeCounterX() - start, kBenchIterations);
+
+  start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    hsm.dispatch(rx);
+  }
+  reportBenchmark(uart, "Hsm dispatch, 50 states, leaf transition",
+      chSysGetRealtimeCounterX() - start, kBenchIterations);
+}
+
+/**
+ * @brief Cost the idle hooks add to every idle enter/leave pair, driven by a
+ *        simulated clock so only the meter's own work is measured
+ */
+static void benchLoadMeterHooks(cal::Uart& uart) {
+  cal::LoadMeter meter;
+  uint32_t now = 0;
+
+  rtcnt_t start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    meter.idleEnter(now += 10);
+    meter.idleLeave(now += 20);
+  }
+  reportBenchmark(uart, "LoadMeter idle enter+leave",
+      chSysGetRealtimeCounterX() - start, kBenchIterations);
+
+  // keep the meter's work from being optimized away
+  meter.sample(now);
+}
+
+/**
+ * @brief Cost of starting, canceling and expiring timers with kBenchIterations
+ *        of them running, expiries spread over every wheel level
+ */
+static void benchTimerWheel(cal::Uart& uart) {
+  // @note Static, the nodes don't fit on a test thread's stack
+  static cal::TimerWheel<kBenchIterations> wheel;
+  static cal::TimerWheelBase::TimerId ids[kBenchIterations];
+  uint32_t now = wheel.now();
+
+  rtcnt_t start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    // pseudo-random delays, from a few ticks to well past level 2
+    ids[i] = wheel.start(now + 1 + (i * 2654435761u) % 300000, 0);
+  }
+  reportBenchmark(uart, "TimerWheel start, 1000 timers",
+      chSysGetRealtimeCounterX() - start, kBenchIterations);
+
+  start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i += 2) {
+    wheel.cancel(ids[i]);
+  }
+  reportBenchmark(uart, "TimerWheel cancel",
+      chSysGetRealtimeCounterX() - start, kBenchIterations / 2);
+
+  // advance to the last expiry, popping as a timer service would
+  uint16_t overruns;
+  uint32_t expired = 0;
+  start = chSysGetRealtimeCounterX();
+  uint32_t next;
+  while (wheel.nextEvent(next)) {
+    wheel.advance(next);
+    while (wheel.popExpired(overruns) != cal::TimerWheelBase::kInvalidTimer) {
+      expired++;
+    }
+  }
+  reportBenchmark(uart, "TimerWheel advance+expire",
+      chSysGetRealtimeCounterX() - start, expired > 0 ? expired : 1);
+}
+
+/**
+ * @brief Cost of recording a latency, over values spread across the buckets
+ */
+static void benchHistogramRecord(cal::Uart& uart) {
+  static cal::Histogram histogram;
+
+  rtcnt_t start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    histogram.record((i * 2654435761u) >> 12);
+  }
+  reportBenchmark(uart, "Histogram record",
+      chSysGetRealtimeCounterX() - start, kBenchIterations);
+}
+
+/**
+ * @brief Cost of counting a stat, versus a plain (non-atomic) increment
+ */
+static void benchCounterIncrement(cal::Uart& uart) {
+  static cal::Counter counter;
+  static volatile uint32_t plain = 0;
+
+  rtcnt_t start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    plain = plain + 1;
+  }
+  reportBenchmark(uart, "volatile increment (baseline)",
+      chSysGetRealtimeCounterX() - start, kBenchIterations);
+
+  start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    counter.increment();
+  }
+  reportBenchmark(uart, "Counter increment",
+      chSysGetRealtimeCounterX() - start, kBenchIterations);
+}
+
+/**
+ * @brief Driver wrapper counting callbacks, with stand-ins for a ChibiOS
+ *        driver and config (callbacks only get the driver)
+ */
+struct BenchDriver;
+struct BenchDriverConfig {
+  void (*callback)(BenchDriver *driverp);
+};
+struct BenchDriver {
+  const BenchDriverConfig *config;
+};
+
+struct BenchCallbackTarget {
+  void onCallback(BenchDriver *) { count++; }
+  void onCall() { count++; }
+
+  uint32_t count = 0;
+};
+
+// the driver-to-instance lookup tables cal::Uart used to search
+static std::array<BenchDriver *, 4> benchRegisteredDrivers = {};
+static std::array<BenchCallbackTarget *, 4> benchDriverToInstance = {};
+
+static void benchLookupCallback(BenchDriver *driverp) {
+  BenchCallbackTarget *instance = nullptr;
+  for (size_t i = 0; i < benchRegisteredDrivers.size(); i++) {
+    if (benchRegisteredDrivers[i] == driverp) {
+      instance = benchDriverToInstance[i];
+    }
+  }
+  instance->onCallback(driverp);
+}
+
+/**
+ * @brief Cost of dispatching a C driver callback to its wrapper instance, and
+ *        of calling a bound member function, each way it's done in the tree
+ */
+static void benchCallbackDispatch(cal::Uart& uart) {
+  BenchCallbackTarget target;
+  cal::DriverConfig<BenchDriverConfig, BenchCallbackTarget> config(&target);
+  BenchDriver driver = {&config.config};
+
+  benchRegisteredDrivers[0] = &driver;
+  benchDriverToInstance[0] = &target;
+  config.config.callback = &benchLookupCallback;
+
+  // called through the driver's config, like the HAL does
+  rtcnt_t start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    driver.config->callback(&driver);
+  }
+  reportBenchmark(uart, "Driver callback, lookup table",
+      chSysGetRealtimeCounterX() - start, kBenchIterations);
+
+  config.config.callback = &cal::DriverCallback<
+      decltype(&BenchCallbackTarget::onCallback),
+      &BenchCallbackTarget::onCallback>::callback;
+
+  start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    driver.config->callback(&driver);
+  }
+  reportBenchmark(uart, "Driver callback, DriverConfig trampoline",
+      chSysGetRealtimeCounterX() - start, kBenchIterations);
+
+  std::function<void()> function = [&target] () { target.onCall(); };
+
+  start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    function();
+  }
+  reportBenchmark(uart, "std::function call",
+      chSysGetRealtimeCounterX() - start, kBenchIterations);
+
+  cal::Delegate<void()> delegate = cal::Delegate<void()>::bind<
+      BenchCallbackTarget, &BenchCallbackTarget::onCall>(target);
+
+  start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    delegate();
+  }
+  reportBenchmark(uart, "Delegate call",
+      chSysGetRealtimeCounterX() - start, kBenchIterations);
+}
+
+/**
+ * @brief Task taking turns with another one, each resume is one switch
+ */
+class BenchPingTask : public cal::Task {
+ public:
+  BenchPingTask(uint32_t& turn, uint32_t me) : m_turn(turn), m_me(me) {}
+
+ private:
+  Status run() override {
+    CAL_TASK_BEGIN();
+    while (true) {
+      CAL_TASK_AWAIT(m_turn == m_me);
+      m_turn = 1 - m_me;
+    }
+    CAL_TASK_END();
+  }
+
+  uint32_t& m_turn;
+  uint32_t m_me;
+};
+
+// smallest working area cal::Thread allows
+static THD_WORKING_AREA(benchYieldWorkingArea, 128);
+static volatile bool benchYielding = false;
+
+static THD_FUNCTION(benchYieldFunc, arg) {
+  (void)arg;
+  while (benchYielding) {
+    chThdYield();
+  }
+}
+
+/**
+ * @brief Cost of switching between two tasks, versus between two threads of
+ *        the same priority, and the RAM each one takes
+ */
+static void benchTaskSwitch(cal::Uart& uart) {
+  uint32_t turn = 0;
+  BenchPingTask ping(turn, 0);
+  BenchPingTask pong(turn, 1);
+
+  rtcnt_t start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    ping.resume(0);
+    pong.resume(0);
+  }
+  reportBenchmark(uart, "Task switch",
+      chSysGetRealtimeCounterX() - start, 2 * kBenchIterations);
+
+  // every yield switches to the other thread and back
+  benchYielding = true;
+  chThdCreateStatic(benchYieldWorkingArea, sizeof(benchYieldWorkingArea),
+      chThdGetPriorityX(), benchYieldFunc, nullptr);
+
+  start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    chThdYield();
+  }
+  reportBenchmark(uart, "Thread switch (chThdYield)",
+      chSysGetRealtimeCounterX() - start, 2 * kBenchIterations);
+
+  // let the other thread exit
+  benchYielding = false;
+  chThdYield();
+
+  uart.send("[ BENCH    ] RAM: ");
+  uart.send(static_cast<int>(sizeof(BenchPingTask)));
+  uart.send(" bytes/task, ");
+  uart.send(static_cast<int>(sizeof(benchYieldWorkingArea)));
+  uart.send(" bytes/thread\r\n");
+  chThdSleepMilliseconds(10);
+}
+
+// a high-rate payload, e.g. a block of ADC samples
+struct BenchBlock {
+  std::array<uint16_t, 32> samples;
+};
+
+// keeps the consumers' reads from being optimized out
+static volatile uint16_t benchBlockSink;
+
+/**
+ * @brief Cost of moving a 64 byte payload from producer to consumer, split
+ *        over CAN-sized events through an EventQueue, versus a Channel
+ */
+static void benchChannel(cal::Uart& uart) {
+  static cal::MutexEventQueue queue;
+  static cal::Channel<BenchBlock, 4> channel;
+  static BenchBlock source;
+  static constexpr size_t kFrameWords = 8;
+
+  for (size_t i = 0; i < source.samples.size(); i++) {
+    source.samples[i] = i;
+  }
+
+  rtcnt_t start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    for (size_t word = 0; word < source.samples.size(); word += kFrameWords) {
+      std::array<uint16_t, kFrameWords> frame;
+      std::copy(&source.samples[word], &source.samples[word + kFrameWords],
+          frame.begin());
+      queue.push(Event(Event::Type::kCanRx, word, frame));
+    }
+    BenchBlock block;
+    for (size_t word = 0; word < block.samples.size(); word += kFrameWords) {
+      std::array<uint16_t, kFrameWords> frame = queue.pop().canFrame();
+      std::copy(frame.begin(), frame.end(), &block.samples[word]);
+    }
+    benchBlockSink = block.samples[i % block.samples.size()];
+  }
+  reportBenchmark(uart, "EventQueue 64 B payload (4 events)",
+      chSysGetRealtimeCounterX() - start, kBenchIterations);
+
+  start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    channel.push(source);
+    BenchBlock block;
+    channel.pop(block);
+    benchBlockSink = block.samples[i % block.samples.size()];
+  }
+  reportBenchmark(uart, "Channel 64 B payload, push+pop",
+      chSysGetRealtimeCounterX() - start, kBenchIterations);
+
+  start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    // written and read in place, e.g. by a DMA completion and its consumer
+    BenchBlock *block = channel.acquire();
+    block->samples[i % block->samples.size()] = i;
+    channel.commit();
+    benchBlockSink = channel.peek()->samples[i % block->samples.size()];
+    channel.release();
+  }
+  reportBenchmark(uart, "Channel 64 B payload, in place",
+      chSysGetRealtimeCounterX() - start, kBenchIterations);
+}
+
+/**
+ * @brief Average push+pop cost of a queue, and its worst single push. With
+ *        the critical section policy, that push is how long interrupts were
+ *        masked, the other policies only mask them briefly inside the kernel.
+ */
+static void benchQueuePolicy(cal::Uart& uart, EventQueue& queue,
+    const char *name, const char *worstName) {
+  Event e(Event::Type::kUartRx, 'p');
+  rtcnt_t worst = 0;
+
+  rtcnt_t start = chSysGetRealtimeCounterX();
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    queue.push(e);
+    queue.pop();
+  }
+  reportBenchmark(uart, name, chSysGetRealtimeCounterX() - start,
+      kBenchIterations);
+
+  for (uint32_t i = 0; i < kBenchIterations; i++) {
+    rtcnt_t pushStart = chSysGetRealtimeCounterX();
+    queue.push(e);
+    rtcnt_t elapsed = chSysGetRealtimeCounterX() - pushStart;
+    if (elapsed > worst) {
+      worst = elapsed;
+    }
+    queue.pop();
+  }
+  reportBenchmark(uart, worstName, worst, 1);
+}
+
+static void benchEventQueuePolicies(cal::Uart& uart) {
+  static cal::MutexEventQueue mutexQueue;
+  static cal::CriticalSectionEventQueue criticalSectionQueue;
+  static cal::LockFreeEventQueue lockFreeQueue;
+
+  benchQueuePolicy(uart, mutexQueue, "EventQueue push+pop, mutex",
+      "EventQueue worst push, mutex");
+  benchQueuePolicy(uart, criticalSectionQueue,
+      "EventQueue push+pop, critical section",
+      "EventQueue worst push, critical section");
+  benchQueuePolicy(uart, lockFreeQueue, "EventQueue push+pop, lock-free",
+      "EventQueue worst push, lock-free");
+}
+
+static constexpr size_t kBenchMaxProducers = 8;
+
+/**
+ * @brief Producer thread of the multi-producer queue benchmark
+ */
+struct BenchProducer {
+  THD_WORKING_AREA(workingArea, 256);
+  EventQueue *queue;
+  uint32_t events;
+};
+
+static BenchProducer benchProducers[kBenchMaxProducers];
+
+static THD_FUNCTION(benchProducerFunc, arg) {
+  BenchProducer *producer = static_cast<BenchProducer *>(arg);
+  Event e(Event::Type::kUartRx, 'm');
+  for (uint32_t i = 0; i < producer->events; i++) {
+    producer->queue->push(e);
+    // round-robin with the other producers
+    chThdYield();
+  }
+}
+
+/**
+ * @brief Cost per event of producer threads all pushing to one queue and
+ *        the (higher priority) consumer thread draining it, including the
+ *        wakeup and the switches there and back
+ */
+static void benchQueueProducers(cal::Uart& uart, EventQueue& queue,
+    size_t producers, const char *name) {
+  uint32_t perProducer = kBenchIterations / producers;
+  uint32_t total = perProducer * producers;
+  thread_t *threads[kBenchMaxProducers];
+
+  rtcnt_t start = chSysGetRealtimeCounterX();
+  for (size_t i = 0; i < producers; i++) {
+    benchProducers[i].queue = &queue;
+    benchProducers[i].events = perProducer;
+    threads[i] = chThdCreateStatic(benchProducers[i].workingArea,
+        sizeof(benchProducers[i].workingArea), chThdGetPriorityX() - 1,
+        benchProducerFunc, &benchProducers[i]);
+  }
+
+  uint32_t received = 0;
+  while (received < total) {
+    // a dropped event would hang the benchmark
+    if (!queue.wait(MS2ST(100))) {
+      break;
+    }
+    Event e;
+    while (queue.tryPop(e)) {
+      received++;
+    }
+  }
+  rtcnt_t elapsed = chSysGetRealtimeCounterX() - start;
+
+  for (size_t i = 0; i < producers; i++) {
+    chThdWait(threads[i]);
+  }
+  reportBenchmark(uart, name, elapsed, received);
+}
+
+/**
+ * @brief The mutex queue versus the lock-free one as producers are added
+ * @note On one core, producers only contend when one preempts another
+ *       mid-push, what grows with their count is the work per push
+ */
+static void benchMultiProducerQueues(cal::Uart& uart) {
+  static cal::MutexEventQueue mutexQueue;
+  static cal::LockFreeEventQueue lockFreeQueue;
+  static const size_t counts[] = { 1, 2, 4, 8 };
+  static const char *const names[][2] = {
+    { "EventQueue 1 producer, mutex", "EventQueue 1 producer, lock-free" },
+    { "EventQueue 2 producers, mutex", "EventQueue 2 producers, lock-free" },
+    { "EventQueue 4 producers, mutex", "EventQueue 4 producers, lock-free" },
+    { "EventQueue 8 producers, mutex", "EventQueue 8 producers, lock-free" },
+  };
+  static_assert(sizeof(counts) / sizeof(counts[0])
+      == sizeof(names) / sizeof(names[0]), "a name per producer count");
+
+  for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+    benchQueueProducers(uart, mutexQueue, counts[i], names[i][0]);
+    benchQueueProducers(uart, lockFreeQueue, counts[i], names[i][1]);
+  }
+}
+
+/**
+ * @brief Cost of a printf to the UART, formatting and queueing it on the TX
+ *        ring, the wire isn't waited for
+ */
+static void benchUartPrintf(cal::Uart& uart) {
+  static constexpr uint32_t kPrints = 100;
+  static constexpr size_t kPrintLen = sizeof("[ BENCH    ] 4294967295\r\n");
+  rtcnt_t total = 0;
+
+  for (uint32_t i = 0; i < kPrints; i++) {
+    // time only prints that fit, not drops
+    while (uart.txFree() < kPrintLen) {
+      chThdSleepMilliseconds(1);
+    }
+    rtcnt_t start = chSysGetRealtimeCounterX();
+    uart.printf("[ BENCH    ] %u\r\n", static_cast<unsigned>(i));
+    total += chSysGetRealtimeCounterX() - start;
+  }
+  reportBenchmark(uart, "Uart printf", total, kPrints);
+}
+
+static void runBenchmarks(cal::Uart& uart) {
+  benchEventBusFanOut(uart);
+  benchHsmDispatch(uart);
+  benchLoadMeterHooks(uart);
+  benchTimerWheel(uart);
+  benchHistogramRecord(uart);
+  benchCounterIncrement(uart);
+  benchCallbackDispatch(uart);
+  benchTaskSwitch(uart);
+  benchChannel(uart);
+  benchEventQueuePolicies(uart);
+  benchMultiProducerQueues(uart);
+  benchUartPrintf(uart);
+}
@@ -0,0 +1,1268 @@
+#include <utest/utest.hpp>
+
+#include <stdint.h>
+
+#include <array>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include "../Channel.h"
+#include "../Clock.h"
+#include "../Debouncer.h"
+#include "../Delegate.h"
+#include "../DriverCallback.h"
+#include "../Event.h"
+#include "../EventBus.h"
+#include "../EventQueue.h"
+#include "../EventTrace.h"
+#include "../ExtendedCounter.h"
+#include "../FixedString.h"
+#include "../Histogram.h"
+#include "../Hsm.h"
+#include "../LoadMeter.h"
+#include "../PayloadPool.h"
+#include "../Stats.h"
+#include "../Task.h"
+#include "../TimerWheel.h"
+#include "../../subsystems/uart/Uart.h"
+
+/**
+ * @brief Minimal stand-in for a ChibiOS driver and its config, callbacks only
+ *        get the driver
+ */
+struct FakeDriver;
+struct FakeDriverConfig {
+  void (*callback)(FakeDriver *driverp, int code);
+};
+struct FakeDriver {
+  const FakeDriverConfig *config;
+};
+
+/**
+ * @brief Move-only channel item, counting live instances
+ */
+struct ChannelItem {
+  explicit ChannelItem(int v) : value(new int(v)) { live++; }
+  ChannelItem(ChannelItem&& other) : value(std::move(other.value)) { live++; }
+  ChannelItem& operator=(ChannelItem&& other) = default;
+  ~ChannelItem() { live--; }
+
+  std::unique_ptr<int> value;
+  static int live;
+};
+
+int ChannelItem::live = 0;
+
+static utest::TestRunner channelTests([] (utest::TestSuite& test_suite) {
+  test_suite.name("Channel").run([] (utest::TestCase& test_case) {
+    test_case.name("fifo_across_wraps").run([] (utest::TestParams& p) {
+      cal::Channel<int, 4> channel;
+      int next = 0;
+      int expected = 0;
+
+      // fill and drain unevenly so the slots wrap many times
+      for (int round = 0; round < 20; round++) {
+        while (channel.push(next)) {
+          next++;
+        }
+        utest::TestAssert{p}.equal(channel.size(), 4u);
+        for (int i = 0; i < 1 + round % 4; i++) {
+          int value = -1;
+          utest::TestAssert{p}.equal(channel.pop(value), true);
+          utest::TestAssert{p}.equal(value, expected++);
+        }
+      }
+      utest::TestAssert{p}.equal(channel.rejectedPushes(), 20u);
+    });
+    test_case.name("borrowed_in_place").run([] (utest::TestParams& p) {
+      cal::Channel<std::array<uint8_t, 64>, 2> channel;
+
+      // nothing is visible until committed
+      std::array<uint8_t, 64> *block = channel.acquire();
+      utest::TestAssert{p}.equal(block != nullptr, true);
+      utest::TestAssert{p}.equal(channel.peek() == nullptr, true);
+      (*block)[63] = 42;
+      channel.commit();
+
+      // the consumer reads the very slot the producer wrote
+      utest::TestAssert{p}.equal(channel.peek() == block, true);
+      utest::TestAssert{p}.equal((*channel.peek())[63], 42);
+      channel.release();
+      utest::TestAssert{p}.equal(channel.size(), 0u);
+    });
+    test_case.name("move_only_items").run([] (utest::TestParams& p) {
+      {
+        cal::Channel<ChannelItem, 4> channel;
+        channel.emplace(1);
+        channel.push(ChannelItem(2));
+        channel.emplace(3);
+        utest::TestAssert{p}.equal(ChannelItem::live, 3);
+
+        ChannelItem item(0);
+        utest::TestAssert{p}.equal(channel.pop(item), true);
+        utest::TestAssert{p}.equal(*item.value, 1);
+        channel.release();
+        utest::TestAssert{p}.equal(ChannelItem::live, 2);
+      }
+      // the remaining item is destroyed with the channel
+      utest::TestAssert{p}.equal(ChannelItem::live, 0);
+    });
+  });
+});
+
+/**
+ * @brief A raw edge of a simulated input trace
+ */
+struct TraceEdge {
+  uint32_t time;
+  bool level;
+};
+
+/**
+ * @brief Play a simulated edge trace through a debouncer the same way
+ *        cal::DigitalIn does on target: every edge (re)arms a settle check
+ *        one window later, and only the last armed check actually fires
+ * @return Number of settled transitions, the last one's state and timestamp
+ *         are written to the out params
+ */
+template <size_t N>
+static uint32_t playTrace(cal::Debouncer& debouncer,
+    const TraceEdge (&trace)[N], bool& lastState, uint32_t& lastTime) {
+  uint32_t transitions = 0;
+
+  for (size_t i = 0; i < N; i++) {
+    debouncer.edge(trace[i].time);
+
+    // the settle timer fires if the next edge doesn't re-arm it first
+    uint32_t deadline = trace[i].time + debouncer.window();
+    if (i + 1 == N
+        || trace[i + 1].time - trace[i].time >= debouncer.window()) {
+      uint32_t timestamp = 0;
+      if (debouncer.settle(deadline, trace[i].level, timestamp)) {
+        transitions++;
+        lastState = debouncer.state();
+        lastTime = timestamp;
+      }
+    }
+  }
+
+  return transitions;
+}
+
+static utest::TestRunner debouncerTests([] (utest::TestSuite& test_suite) {
+  test_suite.name("Debouncer").run([] (utest::TestCase& test_case) {
+    test_case.name("chatter_settles_once").run([] (utest::TestParams& p) {
+      cal::Debouncer debouncer(200, false);
+      // bouncy press: 6 raw edges within 5 ms, then stable high
+      const TraceEdge trace[] = {
+        {1000, true}, {1010, false}, {1030, true}, {1035, false},
+        {1042, true}, {1050, true}
+      };
+      bool state = false;
+      uint32_t time = 0;
+
+      utest::TestAssert{p}.equal(playTrace(debouncer, trace, state, time),
+          1u);
+      utest::TestAssert{p}.equal(state, true);
+      // stamped with the first edge of the burst
+      utest::TestAssert{p}.equal(time, 1000u);
+      utest::TestAssert{p}.equal(debouncer.rawEdges(), 6u);
+    });
+    test_case.name("glitch_is_ignored").run([] (utest::TestParams& p) {
+      cal::Debouncer debouncer(200, false);
+      // short spike that returns low before the window expires
+      const TraceEdge trace[] = {{500, true}, {520, false}};
+      bool state = false;
+      uint32_t time = 0;
+
+      utest::TestAssert{p}.equal(playTrace(debouncer, trace, state, time),
+          0u);
+      utest::TestAssert{p}.equal(debouncer.state(), false);
+    });
+    test_case.name("press_and_release").run([] (utest::TestParams& p) {
+      cal::Debouncer debouncer(200, true);
+      // active-low button: bouncy press, hold, bouncy release
+      const TraceEdge trace[] = {
+        {100, false}, {105, true}, {110, false},
+        {2000, true}, {2004, false}, {2009, true}
+      };
+      bool state = false;
+      uint32_t time = 0;
+
+      utest::TestAssert{p}.equal(playTrace(debouncer, trace, state, time),
+          2u);
+      utest::TestAssert{p}.equal(state, true);
+      utest::TestAssert{p}.equal(time, 2000u);
+    });
+    test_case.name("timestamp_wrap").run([] (utest::TestParams& p) {
+      cal::Debouncer debouncer(200, false);
+      // burst straddling the 32-bit timestamp wrap
+      const TraceEdge trace[] = {{0xFFFFFFF0u, true}, {0x00000010u, true}};
+      bool state = false;
+      uint32_t time = 0;
+
+      utest::TestAssert{p}.equal(playTrace(debouncer, trace, state, time),
+          1u);
+      utest::TestAssert{p}.equal(time, 0xFFFFFFF0u);
+    });
+  });
+});
+
+// queues with static storage so the bus table can be built at compile time
+static cal::MutexEventQueue busQueueA;
+static cal::MutexEventQueue busQueueB;
+static constexpr cal::EventBus::Subscription kBusSubscriptions[] = {
+  {Event::Type::kUartRx, &busQueueA},
+  {Event::Type::kUartRx, &busQueueB},
+  {Event::Type::kCanRx, &busQueueB},
+};
+static constexpr cal::EventBus constBus(kBusSubscriptions);
+
+static_assert(constBus.subscriberCount(Event::Type::kUartRx) == 2,
+    "compile-time subscriber table");
+static_assert(constBus.subscriberCount(Event::Type::kAdcConversion) == 0,
+    "compile-time subscriber table");
+
+static utest::TestRunner eventBusTests([] (utest::TestSuite& test_suite) {
+  test_suite.name("EventBus").run([] (utest::TestCase& test_case) {
+    test_case.name("fan_out_by_type").run([] (utest::TestParams& p) {
+      utest::TestAssert{p}.equal(
+          constBus.publish(Event(Event::Type::kUartRx, 'x')), 2u);
+      utest::TestAssert{p}.equal(
+          constBus.publish(Event(Event::Type::kAdcConversion, Gpio::kA1,
+              42u)), 0u);
+
+      utest::TestAssert{p}.equal(busQueueA.size(), 1u);
+      utest::TestAssert{p}.equal(busQueueB.size(), 1u);
+      utest::TestAssert{p}.equal(busQueueA.pop().getByte(), 'x');
+      utest::TestAssert{p}.equal(busQueueB.pop().getByte(), 'x');
+    });
+    test_case.name("runtime_subscribe_limit").run([] (utest::TestParams& p) {
+      cal::EventBus bus;
+      cal::MutexEventQueue queue;
+
+      for (size_t i = 0; i < cal::EventBus::kMaxSubscribers; i++) {
+        utest::TestAssert{p}.equal(
+            bus.subscribe(Event::Type::kTimerTimeout, queue), true);
+      }
+      utest::TestAssert{p}.equal(
+          bus.subscribe(Event::Type::kTimerTimeout, queue), false);
+      utest::TestAssert{p}.equal(
+          bus.subscriberCount(Event::Type::kTimerTimeout),
+          cal::EventBus::kMaxSubscribers);
+    });
+  });
+});
+
+/**
+ * @brief Context for the Hsm tests, logs entry (uppercase) and exit
+ *        (lowercase) actions by state letter
+ */
+struct HsmLog {
+  char log[32] = {};
+  size_t length = 0;
+  uint32_t handled = 0;
+
+  void append(char c) {
+    if (length < sizeof(log) - 1) {
+      log[length++] = c;
+      log[length] = '\0';
+    }
+  }
+
+  bool equals(const char *expected) const {
+    return std::strcmp(log, expected) == 0;
+  }
+
+  void clear() {
+    length = 0;
+    log[0] = '\0';
+  }
+};
+
+// Root(R) { Idle(I), Active(A) { ActiveA(X), ActiveB(Y) } }
+enum HsmTestState : uint8_t { kRoot, kIdle, kActive, kActiveA, kActiveB };
+using HsmTestTable = cal::HsmTable<HsmLog, 5>;
+static constexpr HsmTestTable::StateId kNone = HsmTestTable::kNoState;
+
+// @note Plain functions rather than lambdas, lambda to function pointer
+//       conversion isn't constexpr before C++17
+static void enterRoot(HsmLog& l) { l.append('R'); }
+static void enterIdle(HsmLog& l) { l.append('I'); }
+static void exitIdle(HsmLog& l) { l.append('i'); }
+static void enterActive(HsmLog& l) { l.append('A'); }
+static void exitActive(HsmLog& l) { l.append('a'); }
+static void enterActiveA(HsmLog& l) { l.append('X'); }
+static void exitActiveA(HsmLog& l) { l.append('x'); }
+static void enterActiveB(HsmLog& l) { l.append('Y'); }
+static void exitActiveB(HsmLog& l) { l.append('y'); }
+
+static HsmTestTable::StateId toActive(HsmLog&, Event&) { return kActive; }
+static HsmTestTable::StateId toIdle(HsmLog&, Event&) { return kIdle; }
+static HsmTestTable::StateId toActiveB(HsmLog&, Event&) { return kActiveB; }
+static HsmTestTable::StateId countHandled(HsmLog& l, Event&) {
+  l.handled++;
+  return kNone;
+}
+
+static constexpr HsmTestTable::State kHsmTestStates[] = {
+  {kNone, kIdle, &enterRoot, nullptr},
+  {kRoot, kNone, &enterIdle, &exitIdle},
+  {kRoot, kActiveA, &enterActive, &exitActive},
+  {kActive, kNone, &enterActiveA, &exitActiveA},
+  {kActive, kNone, &enterActiveB, &exitActiveB},
+};
+
+static constexpr HsmTestTable::Transition kHsmTestTransitions[] = {
+  {kIdle, Event::Type::kUartRx, &toActive},
+  {kActive, Event::Type::kTimerTimeout, &toIdle},
+  {kActiveA, Event::Type::kUartRx, &toActiveB},
+  {kActiveB, Event::Type::kUartRx, &toActiveB},
+  {kRoot, Event::Type::kCanRx, &countHandled},
+};
+
+static constexpr HsmTestTable kHsmTestTable(kHsmTestStates,
+    kHsmTestTransitions, kRoot);
+
+// flattening happens at compile time
+static_assert(kHsmTestTable.handler(kActiveB, Event::Type::kTimerTimeout)
+    == kHsmTestTable.handler(kActive, Event::Type::kTimerTimeout),
+    "substates inherit their parent's handlers");
+static_assert(kHsmTestTable.handler(kIdle, Event::Type::kAdcConversion)
+    == nullptr, "unhandled types stay unhandled");
+
+static utest::TestRunner hsmTests([] (utest::TestSuite& test_suite) {
+  test_suite.name("Hsm").run([] (utest::TestCase& test_case) {
+    test_case.name("start_enters_initial_path").run([] (utest::TestParams& p) {
+      HsmLog log;
+      cal::Hsm<HsmLog, 5> hsm(kHsmTestTable, log);
+
+      hsm.start();
+      utest::TestAssert{p}.equal(hsm.current(), kIdle);
+      utest::TestAssert{p}.equal(log.equals("RI"), true);
+    });
+    test_case.name("entry_exit_order").run([] (utest::TestParams& p) {
+      HsmLog log;
+      cal::Hsm<HsmLog, 5> hsm(kHsmTestTable, log);
+      Event rx(Event::Type::kUartRx, 'r');
+      Event timeout(Event::Type::kTimerTimeout, 't');
+
+      hsm.start();
+      log.clear();
+
+      // Idle -> Active, drills into ActiveA
+      hsm.dispatch(rx);
+      utest::TestAssert{p}.equal(hsm.current(), kActiveA);
+      utest::TestAssert{p}.equal(log.equals("iAX"), true);
+
+      // sibling transition stays within Active
+      log.clear();
+      hsm.dispatch(rx);
+      utest::TestAssert{p}.equal(hsm.current(), kActiveB);
+      utest::TestAssert{p}.equal(log.equals("xY"), true);
+
+      // self-transition exits and re-enters
+      log.clear();
+      hsm.dispatch(rx);
+      utest::TestAssert{p}.equal(log.equals("yY"), true);
+
+      // inherited from Active, exits both levels
+      log.clear();
+      hsm.dispatch(timeout);
+      utest::TestAssert{p}.equal(hsm.current(), kIdle);
+      utest::TestAssert{p}.equal(log.equals("yaI"), true);
+    });
+    test_case.name("inherited_and_unhandled").run([] (utest::TestParams& p) {
+      HsmLog log;
+      cal::Hsm<HsmLog, 5> hsm(kHsmTestTable, log);
+      Event can(Event::Type::kCanRx, 0u, std::array<uint16_t, 8>{});
+      Event adc(Event::Type::kAdcConversion, Gpio::kA1, 1u);
+
+      hsm.start();
+      utest::TestAssert{p}.equal(hsm.dispatch(can), true);
+      utest::TestAssert{p}.equal(log.handled, 1u);
+      utest::TestAssert{p}.equal(hsm.current(), kIdle);
+      utest::TestAssert{p}.equal(hsm.dispatch(adc), false);
+      utest::TestAssert{p}.equal(hsm.isIn(kRoot), true);
+    });
+  });
+});
+
+static utest::TestRunner eventTests([] (utest::TestSuite& test_suite) {
+  test_suite.name("Event").run([] (utest::TestCase& test_case) {
+    test_case.name("serialize_round_trip").run([] (utest::TestParams& p) {
+      std::array<uint16_t, 8> frame = {1, 2, 3, 0x1234, 5, 6, 7, 0xBEEF};
+      Event e(Event::Type::kCanRx, 0x1ABu, frame);
+      uint8_t buf[Event::kSerializedSize];
+
+      e.serialize(buf);
+      utest::TestAssert{p}.equal(buf[0],
+          static_cast<uint8_t>(Event::Type::kCanRx));
+      // params are little-endian
+      utest::TestAssert{p}.equal(buf[1], 0xABu);
+      utest::TestAssert{p}.equal(buf[2], 0x01u);
+
+      Event copy = Event::deserialize(buf);
+      utest::TestAssert{p}.equal(copy.type(), Event::Type::kCanRx);
+      utest::TestAssert{p}.equal(copy.canEid(), 0x1ABu);
+      utest::TestAssert{p}.equal(copy.canFrame() == frame, true);
+    });
+    test_case.name("deserialize_rejects_bad_type").run(
+        [] (utest::TestParams& p) {
+      uint8_t buf[Event::kSerializedSize] = {0xFF};
+
+      utest::TestAssert{p}.equal(Event::deserialize(buf).type(),
+          Event::Type::kNone);
+    });
+#if CAL_USE_EVENT_TIMESTAMPS
+    test_case.name("stamped_when_produced").run([] (utest::TestParams& p) {
+      Event produced(Event::Type::kUartRx, 'a');
+      uint8_t buf[Event::kSerializedSize];
+      produced.serialize(buf);
+
+      Event replayed = Event::deserialize(buf);
+      utest::TestAssert{p}.equal(replayed.timestamp(), 0u);
+
+      // stamped later, but well within a second
+      replayed.stamp();
+      utest::TestAssert{p}.equal(
+          replayed.timestamp() - produced.timestamp() < cal::Clock::kFrequency,
+          true);
+    });
+#endif
+  });
+});
+
+/**
+ * @brief Behavior every EventQueue policy shares
+ */
+template <class Queue>
+static void checkEventQueue(utest::TestParams& p) {
+  static Queue queue;
+  uint16_t next = 0;
+  uint16_t expected = 0;
+
+  // FIFO across many wraps of the ring, blocking and non-blocking
+  for (int round = 0; round < 20; round++) {
+    for (int i = 0; i < 7; i++) {
+      Event e(Event::Type::kUartRx, 'q');
+      e.setTag(next++);
+      if (round % 2 == 0) {
+        queue.push(e);
+      } else {
+        utest::TestAssert{p}.equal(queue.tryPush(e), true);
+      }
+    }
+    Event e;
+    while (queue.tryPop(e)) {
+      utest::TestAssert{p}.equal(e.tag(), expected++);
+    }
+  }
+  utest::TestAssert{p}.equal(expected, next);
+  utest::TestAssert{p}.equal(queue.pop().type() == Event::Type::kNone, true);
+
+  // an empty queue leaves tryPop()'s event as is
+  Event untouched(Event::Type::kUartRx, 'u');
+  utest::TestAssert{p}.equal(queue.tryPop(untouched), false);
+  utest::TestAssert{p}.equal(untouched.getByte(), 'u');
+  utest::TestAssert{p}.equal(queue.highWater(), 7u);
+  utest::TestAssert{p}.equal(queue.overflows(), 0u);
+
+  // waiting only succeeds once something is queued
+  utest::TestAssert{p}.equal(queue.wait(TIME_IMMEDIATE), false);
+  queue.push(Event(Event::Type::kUartRx, 'w'));
+  utest::TestAssert{p}.equal(queue.wait(TIME_IMMEDIATE), true);
+  utest::TestAssert{p}.equal(queue.pop().getByte(), 'w');
+
+  queue.resetStats();
+  utest::TestAssert{p}.equal(queue.highWater(), 0u);
+}
+
+static constexpr size_t kStressProducers = 4;
+static constexpr uint16_t kStressEvents = 500;
+
+/**
+ * @brief Producer thread of the lock-free queue stress test, pushing its own
+ *        sequence of tagged events
+ */
+struct StressProducer {
+  THD_WORKING_AREA(workingArea, 256);
+  EventQueue *queue;
+  char id;
+  uint32_t rejected;
+};
+
+static THD_FUNCTION(stressProducerFunc, arg) {
+  StressProducer *producer = static_cast<StressProducer *>(arg);
+  for (uint16_t i = 0; i < kStressEvents; i++) {
+    Event e(Event::Type::kUartRx, producer->id);
+    e.setTag(i);
+    while (!producer->queue->tryPush(e)) {
+      // full, let the (lower priority) consumer catch up
+      producer->rejected++;
+      chThdSleep(1);
+    }
+    // staggered sleeps, so producers wake on ticks and preempt each other's
+    // pushes
+    if (i % 8 == static_cast<uint16_t>(producer->id)) {
+      chThdSleep(1);
+    }
+  }
+}
+
+static utest::TestRunner eventQueueTests([] (utest::TestSuite& test_suite) {
+  test_suite.name("EventQueue").run([] (utest::TestCase& test_case) {
+    test_case.name("mutex_policy").run([] (utest::TestParams& p) {
+      checkEventQueue<cal::MutexEventQueue>(p);
+    });
+    test_case.name("critical_section_policy").run([] (utest::TestParams& p) {
+      checkEventQueue<cal::CriticalSectionEventQueue>(p);
+    });
+    test_case.name("lock_free_policy").run([] (utest::TestParams& p) {
+      checkEventQueue<cal::LockFreeEventQueue>(p);
+    });
+    test_case.name("lock_free_rejects_when_full").run(
+        [] (utest::TestParams& p) {
+      static cal::BasicEventQueue<cal::LockFreePolicy, 4> queue;
+      for (uint16_t i = 0; i < 5; i++) {
+        Event e(Event::Type::kUartRx, 'x');
+        e.setTag(i);
+        queue.push(e);
+      }
+      utest::TestAssert{p}.equal(queue.overflows(), 1u);
+      utest::TestAssert{p}.equal(queue.tryPush(Event()), false);
+
+      // the oldest events are kept
+      utest::TestAssert{p}.equal(queue.pop().tag(), 0u);
+      utest::TestAssert{p}.equal(queue.size(), 3u);
+    });
+    test_case.name("lock_free_many_producers").run(
+        [] (utest::TestParams& p) {
+      static cal::BasicEventQueue<cal::LockFreePolicy, 16> queue;
+      static StressProducer producers[kStressProducers];
+      thread_t *threads[kStressProducers];
+
+      // producers above the consumer, each at its own priority
+      for (size_t i = 0; i < kStressProducers; i++) {
+        producers[i].queue = &queue;
+        producers[i].id = static_cast<char>(i);
+        producers[i].rejected = 0;
+        threads[i] = chThdCreateStatic(producers[i].workingArea,
+            sizeof(producers[i].workingArea), chThdGetPriorityX() + 1 + i,
+            stressProducerFunc, &producers[i]);
+      }
+
+      // every event arrives once, in its producer's order
+      std::array<uint16_t, kStressProducers> next = {};
+      size_t received = 0;
+      bool ordered = true;
+      systime_t start = chVTGetSystemTimeX();
+      while (received < kStressProducers * kStressEvents
+          && chVTTimeElapsedSinceX(start) < S2ST(5)) {
+        Event e = queue.pop();
+        if (e.type() == Event::Type::kNone) {
+          chThdYield();
+          continue;
+        }
+        size_t id = static_cast<size_t>(e.getByte());
+        ordered = ordered && id < kStressProducers && e.tag() == next[id]++;
+        received++;
+      }
+
+      uint32_t rejected = 0;
+      for (size_t i = 0; i < kStressProducers; i++) {
+        chThdWait(threads[i]);
+        rejected += producers[i].rejected;
+      }
+      utest::TestAssert{p}.equal(received, kStressProducers * kStressEvents);
+      utest::TestAssert{p}.equal(ordered, true);
+      utest::TestAssert{p}.equal(queue.size(), 0u);
+      // a full queue is the only way a lock-free push fails
+      utest::TestAssert{p}.equal(queue.overflows(), rejected);
+      utest::TestAssert{p}.equal(queue.failedPushes(), 0u);
+    });
+    test_case.name("high_water_and_overflows").run([] (utest::TestParams& p) {
+      cal::MutexEventQueue queue;
+
+      // one more than fits, the oldest event is overwritten
+      for (uint16_t i = 0; i < 21; i++) {
+        Event e(Event::Type::kUartRx, 'x');
+        e.setTag(i);
+        queue.push(e);
+      }
+      utest::TestAssert{p}.equal(queue.highWater(), 20u);
+      utest::TestAssert{p}.equal(queue.overflows(), 1u);
+      utest::TestAssert{p}.equal(queue.pop().tag(), 1u);
+
+      // high-water restarts from the current length
+      queue.resetStats();
+      utest::TestAssert{p}.equal(queue.highWater(), 19u);
+      utest::TestAssert{p}.equal(queue.overflows(), 0u);
+    });
+    test_case.name("overflow_policies").run([] (utest::TestParams& p) {
+      using Queue = cal::BasicEventQueue<cal::MutexPolicy, 2>;
+      Queue reject(cal::OverflowPolicy::kReject);
+      Queue dropOldest(cal::OverflowPolicy::kDropOldest);
+      Queue dropNewest(cal::OverflowPolicy::kDropNewest);
+      Queue block(cal::OverflowPolicy::kBlock, TIME_IMMEDIATE);
+      for (EventQueue *queue : {static_cast<EventQueue *>(&reject),
+          static_cast<EventQueue *>(&dropOldest),
+          static_cast<EventQueue *>(&dropNewest),
+          static_cast<EventQueue *>(&block)}) {
+        queue->push(Event(Event::Type::kUartRx, 'a'));
+        queue->push(Event(Event::Type::kUartRx, 'b'));
+      }
+
+      Event e(Event::Type::kCanRx, 0u, std::array<uint16_t, 8>{});
+      utest::TestAssert{p}.equal(reject.push(e) == cal::PushStatus::kRejected,
+          true);
+      utest::TestAssert{p}.equal(
+          dropOldest.push(e) == cal::PushStatus::kDroppedOldest, true);
+      utest::TestAssert{p}.equal(
+          dropNewest.push(e) == cal::PushStatus::kDroppedNewest, true);
+      utest::TestAssert{p}.equal(block.push(e) == cal::PushStatus::kTimedOut,
+          true);
+      // a non-blocking push never waits or drops the new event
+      utest::TestAssert{p}.equal(block.tryPush(e), false);
+      utest::TestAssert{p}.equal(dropNewest.tryPush(e), false);
+
+      // what's kept
+      utest::TestAssert{p}.equal(reject.pop().getByte(), 'a');
+      utest::TestAssert{p}.equal(dropOldest.pop().getByte(), 'b');
+      utest::TestAssert{p}.equal(
+          dropOldest.pop().type() == Event::Type::kCanRx, true);
+      utest::TestAssert{p}.equal(dropNewest.pop().getByte(), 'a');
+      utest::TestAssert{p}.equal(dropNewest.pop().getByte(), 'b');
+
+      // overflows are counted per type of the event that didn't make it
+      utest::TestAssert{p}.equal(dropOldest.overflows(Event::Type::kUartRx),
+          1u);
+      utest::TestAssert{p}.equal(dropOldest.overflows(Event::Type::kCanRx),
+          0u);
+      utest::TestAssert{p}.equal(block.overflows(Event::Type::kCanRx), 2u);
+      utest::TestAssert{p}.equal(block.overflows(), 2u);
+
+      // a pop makes room for the blocked producer
+      block.pop();
+      utest::TestAssert{p}.equal(block.push(e) == cal::PushStatus::kOk, true);
+      block.resetStats();
+      utest::TestAssert{p}.equal(block.overflows(Event::Type::kCanRx), 0u);
+    });
+  });
+});
+
+static utest::TestRunner eventTraceTests([] (utest::TestSuite& test_suite) {
+  test_suite.name("EventTrace").run([] (utest::TestCase& test_case) {
+    test_case.name("capture_and_replay").run([] (utest::TestParams& p) {
+      static cal::EventTrace trace;
+      cal::MutexEventQueue queue;
+      queue.setTrace(&trace, 7);
+
+      queue.push(Event(Event::Type::kUartRx, 'a'));
+      queue.push(Event(Event::Type::kUartRx, 'b'));
+      queue.pop();
+      utest::TestAssert{p}.equal(trace.size(), 3u);
+
+      // drain in batches too small for every record, like the UART does
+      static uint8_t stream[3*(cal::EventTrace::kHeaderSize
+          + cal::EventTrace::kRecordSize)];
+      size_t len = 0;
+      size_t n;
+      while ((n = trace.read(stream + len, cal::EventTrace::kHeaderSize
+              + cal::EventTrace::kRecordSize)) > 0) {
+        len += n;
+      }
+      utest::TestAssert{p}.equal(trace.size(), 0u);
+
+      // replay the consumer's side, pops in capture order
+      char popped[4] = {};
+      size_t pops = 0;
+      size_t records = cal::EventTrace::replay(stream, len,
+          [&] (cal::EventTrace::Record& r) {
+        utest::TestAssert{p}.equal(r.queueId, 7u);
+        if (r.op == cal::EventTrace::kPop) {
+          popped[pops++] = r.event.getByte();
+        }
+      });
+      utest::TestAssert{p}.equal(records, 3u);
+      utest::TestAssert{p}.equal(pops, 1u);
+      utest::TestAssert{p}.equal(popped[0], 'a');
+    });
+    test_case.name("full_ring_drops_oldest").run([] (utest::TestParams& p) {
+      static cal::EventTrace trace;
+      Event e(Event::Type::kUartRx, 'x');
+
+      for (size_t i = 0; i < cal::EventTrace::kCapacity + 2; i++) {
+        e.setTag(static_cast<uint16_t>(i));
+        trace.record(cal::EventTrace::kPush, 0, e);
+      }
+      utest::TestAssert{p}.equal(trace.size(), cal::EventTrace::kCapacity);
+      utest::TestAssert{p}.equal(trace.lost(), 2u);
+
+      uint8_t batch[cal::EventTrace::kHeaderSize
+        + cal::EventTrace::kRecordSize];
+      trace.read(batch, sizeof(batch));
+      cal::EventTrace::replay(batch, sizeof(batch),
+          [&] (cal::EventTrace::Record& r) {
+        utest::TestAssert{p}.equal(r.event.tag(), 2u);
+      });
+    });
+  });
+});
+
+static utest::TestRunner extendedCounterTests(
+    [] (utest::TestSuite& test_suite) {
+  test_suite.name("ExtendedCounter").run([] (utest::TestCase& test_case) {
+    test_case.name("extends_across_wraps").run([] (utest::TestParams& p) {
+      cal::ExtendedCounter counter(0xFFFFFF00u);
+
+      utest::TestAssert{p}.equal(counter.extend(0xFFFFFFF0u), 0xFFFFFFF0ull);
+      utest::TestAssert{p}.equal(counter.extend(0x00000010u), 0x100000010ull);
+
+      // one reading per wrap is enough
+      utest::TestAssert{p}.equal(counter.extend(0x80000000u), 0x180000000ull);
+      utest::TestAssert{p}.equal(counter.extend(0x7FFFFFFFu), 0x27FFFFFFFull);
+      utest::TestAssert{p}.equal(counter.value(), 0x27FFFFFFFull);
+    });
+    test_case.name("same_reading_is_stable").run([] (utest::TestParams& p) {
+      cal::ExtendedCounter counter;
+
+      counter.extend(1234u);
+      utest::TestAssert{p}.equal(counter.extend(1234u), 1234ull);
+      utest::TestAssert{p}.equal(counter.value(), 1234ull);
+    });
+  });
+});
+
+static utest::TestRunner histogramTests([] (utest::TestSuite& test_suite) {
+  test_suite.name("Histogram").run([] (utest::TestCase& test_case) {
+    test_case.name("bucket_bounds").run([] (utest::TestParams& p) {
+      // exact below kSubBuckets, then kSubBuckets per power of two
+      utest::TestAssert{p}.equal(cal::Histogram::bucket(7), 7u);
+      utest::TestAssert{p}.equal(cal::Histogram::bucket(8), 8u);
+      utest::TestAssert{p}.equal(cal::Histogram::bucket(16), 16u);
+      utest::TestAssert{p}.equal(cal::Histogram::bucket(17), 16u);
+      utest::TestAssert{p}.equal(cal::Histogram::bucket(18), 17u);
+      utest::TestAssert{p}.equal(cal::Histogram::bucket(0xFFFFFFFFu),
+          cal::Histogram::kBuckets - 1);
+
+      // every bucket's max is the last value mapping to it
+      bool contiguous = true;
+      for (size_t b = 0; b + 1 < cal::Histogram::kBuckets; b++) {
+        uint32_t max = cal::Histogram::bucketMax(b);
+        contiguous &= cal::Histogram::bucket(max) == b
+            && cal::Histogram::bucket(max + 1) == b + 1;
+      }
+      utest::TestAssert{p}.equal(contiguous, true);
+    });
+    test_case.name("percentiles").run([] (utest::TestParams& p) {
+      static cal::Histogram h;
+      h.reset();
+
+      // 1..1000, plus a single spike
+      for (uint32_t v = 1; v <= 1000; v++) {
+        h.record(v);
+      }
+      h.record(50000);
+
+      cal::Histogram::Snapshot s = h.snapshot();
+      utest::TestAssert{p}.equal(s.count, 1001u);
+      utest::TestAssert{p}.equal(s.max, 50000u);
+      // within a bucket (12.5%) above the exact percentile
+      utest::TestAssert{p}.equal(s.p50 >= 501 && s.p50 <= 564, true);
+      utest::TestAssert{p}.equal(s.p99 >= 991 && s.p99 <= 1023, true);
+      utest::TestAssert{p}.equal(s.p999, 1023u);
+    });
+    test_case.name("snapshot_and_reset").run([] (utest::TestParams& p) {
+      static cal::Histogram h;
+      h.reset();
+
+      h.record(3);
+      h.record(3);
+      cal::Histogram::Snapshot s = h.snapshotAndReset();
+      utest::TestAssert{p}.equal(s.count, 2u);
+      utest::TestAssert{p}.equal(s.p50, 3u);
+      utest::TestAssert{p}.equal(s.max, 3u);
+
+      s = h.snapshot();
+      utest::TestAssert{p}.equal(s.count, 0u);
+      utest::TestAssert{p}.equal(s.p99, 0u);
+    });
+  });
+});
+
+static utest::TestRunner payloadPoolTests([] (utest::TestSuite& test_suite) {
+  test_suite.name("PayloadPool").run([] (utest::TestCase& test_case) {
+    test_case.name("blocks_return_on_last_release").run(
+        [] (utest::TestParams& p) {
+      static cal::PayloadPool<32, 2> pool;
+      cal::Payload *a = pool.alloc();
+      cal::Payload *b = pool.alloc();
+      utest::TestAssert{p}.equal(a != nullptr && b != nullptr, true);
+      utest::TestAssert{p}.equal(pool.alloc() == nullptr, true);
+      utest::TestAssert{p}.equal(pool.allocFailures(), 1u);
+
+      // blocks don't overlap
+      std::memset(a->data(), 0xAA, a->capacity());
+      std::memset(b->data(), 0xBB, b->capacity());
+      utest::TestAssert{p}.equal(a->data()[31], 0xAA);
+      a->setSize(100);
+      utest::TestAssert{p}.equal(a->size(), 32u);
+
+      a->retain();
+      a->release();
+      utest::TestAssert{p}.equal(pool.available(), 0u);
+      a->release();
+      b->release();
+      utest::TestAssert{p}.equal(pool.available(), 2u);
+      utest::TestAssert{p}.equal(pool.alloc()->refs(), 1u);
+    });
+    test_case.name("fanned_out_and_overwritten").run(
+        [] (utest::TestParams& p) {
+      static cal::PayloadPool<64, 4> pool;
+      static cal::MutexEventQueue queues[3];
+      cal::EventBus bus;
+      for (EventQueue& queue : queues) {
+        bus.subscribe(Event::Type::kCanRx, queue);
+      }
+
+      // one reference per subscriber, none left with the publisher
+      cal::Payload *burst = pool.alloc();
+      bus.publish(Event(Event::Type::kCanRx, burst));
+      utest::TestAssert{p}.equal(burst->refs(), 3u);
+      for (EventQueue& queue : queues) {
+        Event e = queue.pop();
+        utest::TestAssert{p}.equal(e.payload() == burst, true);
+        e.releasePayload();
+      }
+      utest::TestAssert{p}.equal(pool.available(), 4u);
+
+      // events overwritten in a full queue release theirs
+      static cal::PayloadPool<8, 24> frames;
+      for (size_t i = 0; i < 24; i++) {
+        queues[0].push(Event(Event::Type::kUartRx, frames.alloc()));
+      }
+      utest::TestAssert{p}.equal(frames.available(), 24 - queues[0].size());
+      while (queues[0].size() > 0) {
+        queues[0].pop().releasePayload();
+      }
+      utest::TestAssert{p}.equal(frames.available(), 24u);
+
+      // publishing to nobody releases it too
+      bus.publish(Event(Event::Type::kTimerTimeout, pool.alloc()));
+      utest::TestAssert{p}.equal(pool.available(), 4u);
+    });
+  });
+});
+
+static utest::TestRunner statsTests([] (utest::TestSuite& test_suite) {
+  test_suite.name("Stats").run([] (utest::TestCase& test_case) {
+    test_case.name("counters_and_gauges").run([] (utest::TestParams& p) {
+      static cal::Counter drops;
+      static uint32_t depth = 7;
+
+      size_t first = cal::Stats::size();
+      utest::TestAssert{p}.equal(cal::Stats::add("test", "drops", drops),
+          true);
+      utest::TestAssert{p}.equal(cal::Stats::add("test", "depth",
+          [] (void *arg) -> uint32_t {
+            return *static_cast<uint32_t *>(arg);
+          }, &depth), true);
+      utest::TestAssert{p}.equal(cal::Stats::size(), first + 2);
+
+      drops.increment();
+      drops.increment(2);
+      depth = 9;
+      utest::TestAssert{p}.equal(cal::Stats::at(first).read(), 3u);
+      utest::TestAssert{p}.equal(cal::Stats::at(first + 1).read(), 9u);
+
+      drops.reset();
+      utest::TestAssert{p}.equal(cal::Stats::at(first).read(), 0u);
+    });
+    test_case.name("prefix_matching").run([] (utest::TestParams& p) {
+      static cal::Counter counter;
+      cal::Stats::Stat stat = {"uart", "rxBytes", &counter, nullptr, nullptr};
+
+      utest::TestAssert{p}.equal(stat.matches(""), true);
+      utest::TestAssert{p}.equal(stat.matches("ua"), true);
+      utest::TestAssert{p}.equal(stat.matches("uart"), true);
+      utest::TestAssert{p}.equal(stat.matches("uart.rx"), true);
+      utest::TestAssert{p}.equal(stat.matches("uart.rxBytes"), true);
+      utest::TestAssert{p}.equal(stat.matches("uart.tx"), false);
+      utest::TestAssert{p}.equal(stat.matches("uartRx"), false);
+      utest::TestAssert{p}.equal(stat.matches("fsm"), false);
+    });
+  });
+});
+
+/**
+ * @brief Target for delegates, and a driver wrapper for trampolines
+ */
+struct DelegateTarget {
+  int add(int n) { return total += n; }
+  int get(int n) const { return total + n; }
+  void done(FakeDriver *, int code) { lastCode = code; }
+
+  int total = 0;
+  int lastCode = 0;
+};
+
+static int doubled(int n) { return 2 * n; }
+
+static utest::TestRunner delegateTests([] (utest::TestSuite& test_suite) {
+  test_suite.name("Delegate").run([] (utest::TestCase& test_case) {
+    test_case.name("binds_every_target").run([] (utest::TestParams& p) {
+      static_assert(std::is_trivially_copyable<cal::Delegate<int(int)>>::value,
+          "delegates are copied from ISRs");
+
+      DelegateTarget target;
+      int offset = 100;
+      auto lambda = [&offset] (int n) { return n + offset; };
+
+      cal::Delegate<int(int)> empty;
+      cal::Delegate<int(int)> member =
+          cal::Delegate<int(int)>::bind<DelegateTarget, &DelegateTarget::add>(
+              target);
+      cal::Delegate<int(int)> constMember = cal::Delegate<int(int)>::bind<
+          DelegateTarget, &DelegateTarget::get>(
+              static_cast<const DelegateTarget&>(target));
+      cal::Delegate<int(int)> function = &doubled;
+      cal::Delegate<int(int)> functor = cal::Delegate<int(int)>::bind(lambda);
+
+      utest::TestAssert{p}.equal(static_cast<bool>(empty), false);
+      utest::TestAssert{p}.equal(member(3), 3);
+      utest::TestAssert{p}.equal(member(4), 7);
+      utest::TestAssert{p}.equal(constMember(1), 8);
+      utest::TestAssert{p}.equal(function(21), 42);
+      utest::TestAssert{p}.equal(functor(1), 101);
+
+      // as a C callback taking the delegate as its argument
+      utest::TestAssert{p}.equal(
+          cal::Delegate<int(int)>::invoke(&function, 5), 10);
+    });
+    test_case.name("driver_callback_finds_instance").run(
+        [] (utest::TestParams& p) {
+      DelegateTarget target;
+      cal::DriverConfig<FakeDriverConfig, DelegateTarget> config(&target);
+      config.config.callback = &cal::DriverCallback<
+          decltype(&DelegateTarget::done), &DelegateTarget::done>::callback;
+
+      // what the HAL does on start, and when the callback fires
+      FakeDriver driver = {&config.config};
+      driver.config->callback(&driver, 7);
+
+      utest::TestAssert{p}.equal(target.lastCode, 7);
+    });
+  });
+});
+
+static utest::TestRunner loadMeterTests([] (utest::TestSuite& test_suite) {
+  test_suite.name("LoadMeter").run([] (utest::TestCase& test_case) {
+    test_case.name("busy_and_idle_share").run([] (utest::TestParams& p) {
+      cal::LoadMeter meter(1000);
+
+      // simulated clock: busy 250, idle 500, busy 100, idle 150
+      meter.idleEnter(1250);
+      meter.idleLeave(1750);
+      meter.idleEnter(1850);
+      meter.idleLeave(2000);
+
+      cal::LoadMeter::Sample s = meter.sample(2000);
+      utest::TestAssert{p}.equal(s.elapsed, 1000u);
+      utest::TestAssert{p}.equal(s.idle, 650u);
+      utest::TestAssert{p}.equal(s.wakeups, 2u);
+      utest::TestAssert{p}.equal(s.loadPermille, 350u);
+    });
+    test_case.name("idle_across_windows").run([] (utest::TestParams& p) {
+      // starts just before the clock wraps
+      cal::LoadMeter meter(0xFFFFFF00u);
+
+      meter.idleEnter(0xFFFFFF00u);
+      cal::LoadMeter::Sample s = meter.sample(0x00000100u);
+      utest::TestAssert{p}.equal(s.elapsed, 0x200u);
+      utest::TestAssert{p}.equal(s.loadPermille, 0u);
+      utest::TestAssert{p}.equal(s.wakeups, 0u);
+
+      // the rest of the idle period counts towards the next window
+      meter.idleLeave(0x00000200u);
+      s = meter.sample(0x00000300u);
+      utest::TestAssert{p}.equal(s.idle, 0x100u);
+      utest::TestAssert{p}.equal(s.wakeups, 1u);
+      utest::TestAssert{p}.equal(s.loadPermille, 500u);
+    });
+  });
+});
+
+static utest::TestRunner timerWheelTests([] (utest::TestSuite& test_suite) {
+  test_suite.name("TimerWheel").run([] (utest::TestCase& test_case) {
+    test_case.name("one_shot_expires_on_time").run([] (utest::TestParams& p) {
+      // delays around every level boundary, and beyond the wheel's range
+      static const uint32_t delays[] = {1, 63, 64, 65, 4095, 4096, 5000,
+        262143, 262144, 300000, cal::TimerWheelBase::kRange + 10};
+      static cal::TimerWheel<4> wheel;
+
+      for (uint32_t delay : delays) {
+        // start off a level boundary, and close to the clock wrapping
+        uint32_t start = 0xFFFFF000u + 37;
+        wheel.advance(start);
+        cal::TimerWheelBase::TimerId id = wheel.start(start + delay, 0);
+        uint16_t overruns;
+
+        wheel.advance(start + delay - 1);
+        utest::TestAssert{p}.equal(wheel.popExpired(overruns),
+            cal::TimerWheelBase::kInvalidTimer);
+
+        wheel.advance(start + delay);
+        utest::TestAssert{p}.equal(wheel.popExpired(overruns), id);
+        utest::TestAssert{p}.equal(wheel.active(), 0u);
+      }
+    });
+    test_case.name("periodic_and_overruns").run([] (utest::TestParams& p) {
+      static cal::TimerWheel<4> wheel;
+      cal::TimerWheelBase::TimerId id = wheel.start(100, 100);
+      uint16_t overruns;
+      uint32_t next;
+
+      wheel.advance(100);
+      utest::TestAssert{p}.equal(wheel.popExpired(overruns), id);
+      utest::TestAssert{p}.equal(overruns, 0u);
+      // the next event may be a cascade ahead of the expiry itself
+      utest::TestAssert{p}.equal(wheel.nextEvent(next), true);
+      utest::TestAssert{p}.equal(next > 100 && next <= 200, true);
+
+      // popped late, 450 is past the 300 and 400 expiries
+      wheel.advance(450);
+      utest::TestAssert{p}.equal(wheel.popExpired(overruns), id);
+      utest::TestAssert{p}.equal(overruns, 2u);
+      wheel.advance(499);
+      utest::TestAssert{p}.equal(wheel.popExpired(overruns),
+          cal::TimerWheelBase::kInvalidTimer);
+      wheel.advance(500);
+      utest::TestAssert{p}.equal(wheel.popExpired(overruns), id);
+      utest::TestAssert{p}.equal(wheel.cancel(id), true);
+    });
+    test_case.name("cancel_and_stale_ids").run([] (utest::TestParams& p) {
+      static cal::TimerWheel<1> wheel;
+      uint16_t overruns;
+
+      cal::TimerWheelBase::TimerId first = wheel.start(10, 0);
+      utest::TestAssert{p}.equal(wheel.start(20, 0),
+          cal::TimerWheelBase::kInvalidTimer);
+      utest::TestAssert{p}.equal(wheel.cancel(first), true);
+      utest::TestAssert{p}.equal(wheel.cancel(first), false);
+
+      // the node is reused, the old ID must not cancel the new timer
+      cal::TimerWheelBase::TimerId second = wheel.start(10, 0);
+      utest::TestAssert{p}.equal(second != first, true);
+      utest::TestAssert{p}.equal(wheel.cancel(first), false);
+
+      // expired but not popped yet
+      wheel.advance(10);
+      utest::TestAssert{p}.equal(wheel.cancel(second), true);
+      utest::TestAssert{p}.equal(wheel.popExpired(overruns),
+          cal::TimerWheelBase::kInvalidTimer);
+    });
+    test_case.name("matches_reference").run([] (utest::TestParams& p) {
+      static constexpr size_t kTimers = 200;
+      static cal::TimerWheel<kTimers> wheel;
+      static uint32_t expiries[kTimers];
+      uint32_t seed = 12345;
+      auto random = [&seed] () {
+        seed = seed * 1103515245u + 12345u;
+        return seed >> 8;
+      };
+
+      for (size_t i = 0; i < kTimers; i++) {
+        uint32_t expiry = wheel.now() + 1 + random() % 20000;
+        expiries[cal::TimerWheelBase::index(wheel.start(expiry, 0))] = expiry;
+      }
+
+      // every timer pops in the step covering its expiry, in expiry order
+      size_t popped = 0;
+      uint32_t last = wheel.now();
+      while (popped < kTimers) {
+        uint32_t previous = wheel.now();
+        wheel.advance(previous + 1 + random() % 700);
+
+        uint16_t overruns;
+        cal::TimerWheelBase::TimerId id;
+        while ((id = wheel.popExpired(overruns))
+            != cal::TimerWheelBase::kInvalidTimer) {
+          uint32_t expiry = expiries[cal::TimerWheelBase::index(id)];
+          utest::TestAssert{p}.equal(expiry > previous, true);
+          utest::TestAssert{p}.equal(expiry <= wheel.now(), true);
+          utest::TestAssert{p}.equal(expiry >= last, true);
+          last = expiry;
+          popped++;
+        }
+      }
+      utest::TestAssert{p}.equal(wheel.active(), 0u);
+    });
+  });
+});
+
+/**
+ * @brief Task awaiting each kind of condition in turn, recording how far it
+ *        got
+ */
+class StepTask : public cal::Task {
+ public:
+  explicit StepTask(EventQueue& queue) : m_queue(queue) {}
+
+  bool go = false;
+  int step = 0;
+  Event event;
+
+ private:
+  Status run() override {
+    CAL_TASK_BEGIN();
+    step = 1;
+    CAL_TASK_AWAIT(go);
+    step = 2;
+    CAL_TASK_SLEEP(10);
+    step = 3;
+    CAL_TASK_AWAIT_EVENT(m_queue, event);
+    step = 4;
+    CAL_TASK_YIELD();
+    step = 5;
+    CAL_TASK_END();
+  }
+
+  EventQueue& m_queue;
+};
+
+static utest::TestRunner taskTests([] (utest::TestSuite& test_suite) {
+  test_suite.name("Task").run([] (utest::TestCase& test_case) {
+    test_case.name("resumes_at_each_await").run([] (utest::TestParams& p) {
+      cal::MutexEventQueue queue;
+      StepTask task(queue);
+      uint32_t when;
+
+      // runs up to the first unmet condition, and stays there
+      utest::TestAssert{p}.equal(task.resume(0) == cal::Task::Status::kWaiting,
+          true);
+      utest::TestAssert{p}.equal(task.step, 1);
+      task.resume(1);
+      utest::TestAssert{p}.equal(task.step, 1);
+
+      // sleeps from the time it was resumed at, close to the clock wrapping
+      uint32_t start = 0xFFFFFFF8u;
+      task.go = true;
+      task.resume(start);
+      utest::TestAssert{p}.equal(task.step, 2);
+      utest::TestAssert{p}.equal(task.deadline(when), true);
+      utest::TestAssert{p}.equal(when, start + 10);
+      task.resume(start + 9);
+      utest::TestAssert{p}.equal(task.step, 2);
+
+      // then waits for an event, which it pops
+      task.resume(start + 10);
+      utest::TestAssert{p}.equal(task.step, 3);
+      utest::TestAssert{p}.equal(task.deadline(when), false);
+      queue.push(Event(Event::Type::kUartRx, 'x'));
+      task.resume(start + 11);
+      utest::TestAssert{p}.equal(task.step, 4);
+      utest::TestAssert{p}.equal(task.event.getByte(), 'x');
+      utest::TestAssert{p}.equal(queue.size(), 0u);
+
+      // yielding is due right away
+      utest::TestAssert{p}.equal(task.deadline(when), true);
+      utest::TestAssert{p}.equal(when, start + 11);
+      utest::TestAssert{p}.equal(task.resume(start + 11)
+          == cal::Task::Status::kDone, true);
+      utest::TestAssert{p}.equal(task.step, 5);
+      utest::TestAssert{p}.equal(task.done(), true);
+    });
+    test_case.name("restarts_from_the_top").run([] (utest::TestParams& p) {
+      cal::MutexEventQueue queue;
+      StepTask task(queue);
+      task.go = true;
+      task.resume(0);
+      task.resume(10);
+      utest::TestAssert{p}.equal(task.step, 3);
+
+      task.restart();
+      task.go = false;
+      task.resume(20);
+      utest::TestAssert{p}.equal(task.step, 1);
+      utest::TestAssert{p}.equal(task.done(), false);
+    });
+  });
+});
+
+/**
+ * @brief Compose a message at compile time, appends are constexpr
+ */
+static constexpr cal::FixedString<16> fixedStringGreeting() {
+  cal::FixedString<16> str("id [");
+  str << -42 << "]";
+  return str;
+}
+
+static constexpr cal::FixedString<16> kFixedStringGreeting =
+    fixedStringGreeting();
+static_assert(kFixedStringGreeting.size() == 8,
+    "cal::FixedString appends at compile time");
+static_assert(kFixedStringGreeting.c_str()[4] == '-',
+    "cal::FixedString formats negative numbers");
+
+// interface the tests report over, set by main() before the tests run
+static cal::Uart *testUart = nullptr;
+
+static utest::TestRunner fixedStringTests([] (utest::TestSuite& test_suite) {
+  test_suite.name("FixedString").run([] (utest::TestCase& test_case) {
+    test_case.name("append_and_format").run([] (utest::TestParams& p) {
+      cal::FixedString<48> str;
+      str << "u [" << 4294967295u << "] i [" << INT32_MIN << "] c ["
+          << 'x' << "]";
+      utest::TestAssert{p}.equal(std::strcmp(str.c_str(),
+          "u [4294967295] i [-2147483648] c [x]"), 0);
+      utest::TestAssert{p}.equal(str.truncated(), false);
+
+      str.clear();
+      str << static_cast<uint64_t>(10000000000ull);
+      str.format(" 0x%04x", 0xbeef);
+      utest::TestAssert{p}.equal(std::strcmp(str.c_str(),
+          "10000000000 0xbeef"), 0);
+      utest::TestAssert{p}.equal(
+          std::strcmp(kFixedStringGreeting.c_str(), "id [-42]"), 0);
+    });
+    test_case.name("truncates_at_capacity").run([] (utest::TestParams& p) {
+      cal::FixedString<8> str;
+      str << "0123456" << 789;
+      utest::TestAssert{p}.equal(str.size(), 8u);
+      utest::TestAssert{p}.equal(std::strcmp(str.c_str(), "01234567"), 0);
+      utest::TestAssert{p}.equal(str.truncated(), true);
+
+      str.clear();
+      str.format("%s", "far too long");
+      utest::TestAssert{p}.equal(std::strcmp(str.c_str(), "far too "), 0);
+      utest::TestAssert{p}.equal(str.truncated(), true);
+    });
+    test_case.name("logging_never_allocates").run([] (utest::TestParams& p) {
+      // the counter sees allocations at all
+      uint32_t before = cal::heapAllocations();
+      std::unique_ptr<uint32_t> allocated(new uint32_t(0));
+      utest::TestAssert{p}.equal(cal::heapAllocations() - before, 1u);
+
+      // a soak of log lines like EventSim's reports, through the real UART
+      // send paths (most are dropped once the TX ring fills, which must not
+      // allocate either)
+      testUart->flush();
+      before = cal::heapAllocations();
+      for (uint32_t i = 0; i < 1000; i++) {
+        cal::FixedString<cal::Uart::kMaxMsgLen - 1> line;
+        line << "Soak: Ending test [" << "Echo Test" << "] with "
+            << (i % 2 == 0 ? "SUCCESS" : "FAILURE") << " in [" << i
+            << "] ms, ";
+        line.format("latency [%u] us.\n", static_cast<unsigned>(i * 3));
+        testUart->send(line);
+        testUart->send(static_cast<int>(i));
+        testUart->printf(" soak [%u]\n", static_cast<unsigned>(i));
+      }
+      utest::TestAssert{p}.equal(cal::heapAllocations() - before, 0u);
+      testUart->flush();
+    });
+  });
+});
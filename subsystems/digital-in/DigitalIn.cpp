@@ -0,0 +1,141 @@
+#include "../../cal.h"
+#include "DigitalIn.h"
+
+// @TODO fix include dirs w/ local Makefile
+#include "../../common/Debouncer.h"
+#include "../../common/Gpio.h"
+#include "../../common/Event.h"
+#include "../../common/EventQueue.h"
+#include "ch.h"
+#include "hal.h"
+// @TODO Define pinconfs for every supported board type so that user code
+//       indicates board and then chibios-subsys knows what pin confs to use
+//       (that facilitates compile-time checks that such pins exist)
+#include "pinconf.h"
+
+// Definitions for static members
+constexpr systime_t cal::DigitalIn::kDefaultDebounce;
+EXTConfig cal::DigitalIn::extConfig = {};
+std::array<cal::DigitalIn *, EXT_MAX_CHANNELS>
+    cal::DigitalIn::channelToSubsysLookup = {};
+bool cal::DigitalIn::extStarted = false;
+
+/**
+ * @brief Configure a pad as an input and sample its level
+ * @note Used from the constructor's initializer list, so the debouncer is
+ *       seeded from the configured pad rather than its reset state
+ */
+static bool configureInput(ioportid_t port, iopadid_t pad) {
+  palSetPadMode(port, pad, PAL_MODE_INPUT);
+  return palReadPad(port, pad) == PAL_HIGH;
+}
+
+/**
+ * TODO: Support configurable pull-ups/downs per input
+ * @note The pin's initial level is taken as its settled state, so no event is
+ *       generated for the state at construction time
+ */
+cal::DigitalIn::DigitalIn(DigitalInput pin, EventQueue& eq,
+    systime_t debounce) : m_pin(pin), m_eventQueue(eq),
+  m_debouncer(debounce, configureInput(port(), pad())) {
+  chVTObjectInit(&m_settleTimer);
+
+  // register instance statically for lookup in static callbacks
+  cal::DigitalIn::channelToSubsysLookup[pad()] = this;
+
+  // the driver must be running before channel modes can be changed
+  if (!cal::DigitalIn::extStarted) {
+    extStart(&EXTD1, &cal::DigitalIn::extConfig);
+    cal::DigitalIn::extStarted = true;
+  }
+
+  // interrupt on both edges of this pin
+  EXTChannelConfig channelConfig = {
+    EXT_CH_MODE_BOTH_EDGES | EXT_CH_MODE_AUTOSTART | extPortMode(),
+    &cal::DigitalIn::edgeCallback
+  };
+  extSetChannelMode(&EXTD1, pad(), &channelConfig);
+}
+
+bool cal::DigitalIn::state() const {
+  return m_debouncer.state();
+}
+
+uint32_t cal::DigitalIn::rawEdges() const {
+  return m_debouncer.rawEdges();
+}
+
+void cal::DigitalIn::edgeCallback(EXTDriver *extp, expchannel_t channel) {
+  static_cast<void>(extp);
+
+  cal::DigitalIn *_this = cal::DigitalIn::channelToSubsysLookup[channel];
+
+  if (_this != nullptr) {
+    chSysLockFromISR();
+    _this->m_debouncer.edge(chVTGetSystemTimeX());
+    // restart the quiet period, every edge pushes the settle check back
+    chVTSetI(&_this->m_settleTimer, _this->m_debouncer.window(),
+        &cal::DigitalIn::settleCallback, _this);
+    chSysUnlockFromISR();
+  }
+}
+
+void cal::DigitalIn::settleCallback(void *arg) {
+  cal::DigitalIn *_this = static_cast<cal::DigitalIn *>(arg);
+
+  uint32_t timestamp = 0;
+
+  chSysLockFromISR();
+  bool level = palReadPad(_this->port(), _this->pad()) == PAL_HIGH;
+  bool settled = _this->m_debouncer.settle(chVTGetSystemTimeX(), level,
+      timestamp);
+  chSysUnlockFromISR();
+
+  if (settled) {
+    Event e = Event(Event::Type::kDigInTransition, _this->m_pin, level,
+        timestamp);
+    // if the event queue cannot be immediately acquired, the push fails
+    bool success = _this->m_eventQueue.tryPush(e);
+    if (!success) {
+      // @note same as the UART subsystem, the transition is dropped when the
+      //       consumer isn't ready to receive it (this LED toggles)
+      palTogglePad(STARTUP_LED_PORT, STARTUP_LED_PIN);
+    }
+  }
+}
+
+ioportid_t cal::DigitalIn::port() const {
+  switch (m_pin) {
+    case DigitalInput::kTriStateUp:
+      return TRI_STATE_SWITCH_UP_PORT;
+    case DigitalInput::kTriStateDown:
+      return TRI_STATE_SWITCH_DOWN_PORT;
+    case DigitalInput::kDriveModeButton:
+      return DRIVE_MODE_BUTTON_PORT;
+    case DigitalInput::kBspdFault:
+    default:
+      return BSPD_FAULT_PORT;
+  }
+}
+
+iopadid_t cal::DigitalIn::pad() const {
+  switch (m_pin) {
+    case DigitalInput::kTriStateUp:
+      return TRI_STATE_SWITCH_UP_PIN;
+    case DigitalInput::kTriStateDown:
+      return TRI_STATE_SWITCH_DOWN_PIN;
+    case DigitalInput::kDriveModeButton:
+      return DRIVE_MODE_BUTTON_PIN;
+    case DigitalInput::kBspdFault:
+    default:
+      return BSPD_FAULT_PIN;
+  }
+}
+
+/**
+ * @TODO Derive this from port() once pinconfs exist for other boards, all
+ *       current digital inputs are on GPIOB
+ */
+uint32_t cal::DigitalIn::extPortMode() const {
+  return EXT_MODE_GPIOB << EXT_MODE_GPIO_OFF;
+}
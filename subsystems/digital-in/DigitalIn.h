@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <array>
+
+// @TODO finish the chibios-subsys common header that includes all (cal.hpp)
+#include "../../cal.h"
+#include "../../common/Debouncer.h"
+#include "../../common/Gpio.h"
+#include "../../common/Event.h"
+#include "../../common/EventQueue.h"
+#include "ch.h"
+#include "hal.h"
+
+namespace cal {
+
+/**
+ * Digital input subsystem, sitting on top of the ChibiOS EXT driver. One
+ * instance is constructed per input pin, and each instance pushes exactly one
+ * kDigInTransition event to its event queue per settled edge of the pin.
+ *
+ * Debouncing is done entirely from interrupts, without a polling thread. Every
+ * raw edge of the pin fires the EXT channel callback, which records the edge
+ * timestamp and (re)arms a one-shot virtual timer for the debounce window.
+ * Once the pin has been quiet for the full window the timer callback samples
+ * the pin, and if it settled on a new state, pushes a single event stamped
+ * with the system time of the first raw edge of the burst. Contact chatter
+ * therefore never reaches the event queue.
+ *
+ * @note Like the UART subsystem, ChibiOS EXT callbacks are static and only
+ *       provide the channel number, so instances are registered in a static
+ *       table indexed by EXT channel (i.e. pin number) for lookup from the
+ *       callbacks
+ * @note EXT channels are shared between ports (e.g. PB11 and PC11 both map to
+ *       channel 11), so only one DigitalIn may be constructed per pin number
+ */
+class DigitalIn {
+ public:
+  // Default debounce window, long enough for typical tactile switches
+  static constexpr systime_t kDefaultDebounce = MS2ST(20);
+
+  /**
+   * @brief Configure the pin as an input and IMMEDIATELY begin pushing
+   *        debounced transition events to the provided event queue
+   * @param pin Digital input to monitor
+   * @param eq Reference to queue to send this subsystem's events to
+   * @param debounce Time the pin must be stable before an edge is reported
+   */
+  DigitalIn(DigitalInput pin, EventQueue& eq,
+      systime_t debounce = kDefaultDebounce);
+
+  // instances are registered by address for the static callbacks
+  DigitalIn(const DigitalIn&) = delete;
+  DigitalIn& operator=(const DigitalIn&) = delete;
+
+  // @return Current debounced state of the pin
+  bool state() const;
+
+  // @return Number of raw (undebounced) edges seen on the pin
+  uint32_t rawEdges() const;
+
+  // @brief Fires on every raw edge of any registered EXT channel
+  static void edgeCallback(EXTDriver *extp, expchannel_t channel);
+
+  // @brief Fires once the debounce window has elapsed after the last edge
+  static void settleCallback(void *arg);
+
+ private:
+  // ChibiOS port, pad and EXT port mode corresponding to m_pin
+  ioportid_t port() const;
+  iopadid_t pad() const;
+  uint32_t extPortMode() const;
+
+  DigitalInput m_pin;
+  EventQueue& m_eventQueue;
+
+  // only touched from within the kernel's ISR critical zone
+  Debouncer m_debouncer;
+  virtual_timer_t m_settleTimer;
+
+  // EXT configuration shared by every DigitalIn instance (EXT only has one
+  // driver) and the instance registered on each EXT channel
+  static EXTConfig extConfig;
+  static std::array<DigitalIn *, EXT_MAX_CHANNELS> channelToSubsysLookup;
+  static bool extStarted;
+};
+
+}
@@ -1,5 +1,4 @@
-#include <functional>
-#include <string>
+#include <array>
 
 #include "../../cal.h"
 #include "../uart/Uart.h"
@@ -9,6 +8,9 @@
 #include "../../common/Gpio.h"
 #include "../../common/Event.h"
 #include "../../common/EventQueue.h"
+#include "../../common/Clock.h"
+#include "../../common/Delegate.h"
+#include "../../common/FixedString.h"
 #include "ch.h"
 #include "hal.h"
 // @TODO Define pinconfs for every supported board type so that user code
@@ -16,25 +18,530 @@
 //       (that facilitates compile-time checks that such pins exist)
 #include "pinconf.h"
 
+// Definitions for static members
+constexpr size_t cal::EventSim::kMaxScenarioEvents;
+constexpr size_t cal::EventSim::kMaxResponses;
+constexpr size_t cal::EventSim::kRecordSize;
+constexpr systime_t cal::EventSim::kByteTimeout;
+constexpr systime_t cal::EventSim::kQuietTimeout;
+constexpr size_t cal::EventSim::kStressWindow;
+constexpr uint32_t cal::EventSim::kMaxStressBurst;
+constexpr size_t cal::EventSim::kLatencyBuckets;
+constexpr size_t cal::EventSim::kMaxTests;
+constexpr size_t cal::EventSim::kTestStackSize;
+
 cal::EventSim::EventSim(cal::Uart& uart, EventQueue& testConsumer) : m_uart(uart),
-  m_testConsumer(testConsumer) {}
+  m_testConsumer(testConsumer) {
+  chVTObjectInit(&m_replayTimer);
+  chVTObjectInit(&m_stressTimer);
+  chSemObjectInit(&m_testsDone, 0);
+
+  for (size_t i = 0; i < kMaxTests; i++) {
+    chBSemObjectInit(&m_workers[i].go, true);
+    m_workers[i].sim = this;
+    m_workers[i].index = i;
+  }
+}
+
+bool cal::EventSim::registerTest(const char *name, TestFunc test) {
+  Test *t = addTest(name, m_testConsumer, test);
+  if (t == nullptr) {
+    return false;
+  }
+  t->monitor = &m_receiveQueue;
+  return true;
+}
+
+EventQueue *cal::EventSim::registerTest(const char *name,
+    EventQueue& testConsumer, TestFunc test) {
+  Test *t = addTest(name, testConsumer, test);
+  if (t == nullptr) {
+    return nullptr;
+  }
+  t->monitor = &m_testMonitors[m_testCount - 1];
+  return t->monitor;
+}
+
+/**
+ * @note Tests against the same consumer would see each other's responses, so
+ *       they're assigned the same worker and run one after another
+ */
+cal::EventSim::Test *cal::EventSim::addTest(const char *name,
+    EventQueue& testConsumer, TestFunc test) {
+  // checked at runtime, debug asserts are usually compiled out
+  if (m_testCount >= kMaxTests) {
+    ReportLine line;
+    line << "EventSim: Too many tests, [" << name << "] not registered.\n";
+    m_uart.send(line);
+    return nullptr;
+  }
+
+  Test& t = m_tests[m_testCount++];
+  t.name = name;
+  t.func = test;
+  t.consumer = &testConsumer;
+
+  t.worker = m_workerCount;
+  for (size_t i = 0; i + 1 < m_testCount; i++) {
+    if (m_tests[i].consumer == &testConsumer) {
+      t.worker = m_tests[i].worker;
+    }
+  }
+  if (t.worker == m_workerCount) {
+    m_workerCount++;
+  }
+
+  return &t;
+}
+
+bool cal::EventSim::runTests() {
+  systime_t start = chVTGetSystemTime();
+  m_finishedCount = 0;
+
+  for (size_t i = 0; i < m_workerCount; i++) {
+    ReportLine line;
+    line << "EventSim: Beginning tests on worker [" << i << "].\n";
+    m_uart.send(line);
+
+    // workers are started on first use, then wait for the next run
+    if (!m_workers[i].thread.isStarted()) {
+      m_workers[i].thread.start<TestWorker, &TestWorker::run>(&m_workers[i]);
+    }
+    chBSemSignal(&m_workers[i].go);
+  }
+
+  // report results in the order tests finish
+  bool allPassed = true;
+  systime_t totalDuration = 0;
+  for (size_t i = 0; i < m_testCount; i++) {
+    chSemWait(&m_testsDone);
+    Test& t = m_tests[m_finished[i]];
+
+    ReportLine line;
+    line << "EventSim: Ending test    [" << t.name << "] with "
+        << (t.result == true ? "SUCCESS" : "FAILURE") << " in ["
+        << ST2MS(t.duration) << "] ms.\n";
+    m_uart.send(line);
+
+    allPassed = allPassed && t.result;
+    totalDuration += t.duration;
+  }
+
+  ReportLine line;
+  line << "EventSim: Ran [" << m_testCount << "] tests on [" << m_workerCount
+      << "] workers in [" << ST2MS(chVTTimeElapsedSinceX(start))
+      << "] ms (sequential [" << ST2MS(totalDuration) << "] ms).\n";
+  m_uart.send(line);
+
+  return allPassed;
+}
+
+void cal::EventSim::TestWorker::run() {
+  while (true) {
+    chBSemWait(&go);
+    sim->runWorkerTests(index);
+  }
+}
+
+void cal::EventSim::runWorkerTests(size_t worker) {
+  for (size_t i = 0; i < m_testCount; i++) {
+    Test& t = m_tests[i];
+    if (t.worker != worker) {
+      continue;
+    }
+
+    // drop stale responses from previous runs
+    Event stale;
+    while (t.monitor->tryPop(stale)) {
+      stale.releasePayload();
+    }
+
+    systime_t start = chVTGetSystemTime();
+    t.result = t.func(*t.consumer, *t.monitor);
+    t.duration = chVTTimeElapsedSinceX(start);
+
+    // the index is recorded before the signal, so the runner never reads an
+    // unwritten entry
+    chSysLock();
+    m_finished[m_finishedCount++] = i;
+    chSysUnlock();
+    chSemSignal(&m_testsDone);
+  }
+}
+
+EventQueue& cal::EventSim::receiveQueue() { return m_receiveQueue; }
+
+bool cal::EventSim::runScenario(EventQueue& uartRx) {
+  if (!receiveScenario(uartRx)) {
+    m_uart.send("EventSim: Scenario discarded (incomplete or too long).\n");
+    return false;
+  }
+
+  // drop stale responses from before the replay
+  Event stale;
+  while (m_receiveQueue.tryPop(stale)) {
+    stale.releasePayload();
+  }
+  m_responseCount = 0;
+  m_droppedInjections = 0;
+
+  // start the replay, offsets are relative to now
+  chSysLock();
+  m_replayIndex = 0;
+  m_replayStart = chVTGetSystemTimeX();
+  m_replayStartTime = cal::Clock::now32();
+  scheduleNextI();
+  chSysUnlock();
+
+  // capture responses until every event was injected and the consumer has
+  // been quiet for a while
+  while (true) {
+    if (m_receiveQueue.wait(kQuietTimeout)) {
+      Event e = m_receiveQueue.pop();
+      if (m_responseCount < kMaxResponses) {
+        m_responses[m_responseCount++] = {elapsedUs(), e};
+      }
+    } else if (m_replayIndex >= m_scenarioLength) {
+      break;
+    }
+  }
+
+  reportScenario();
+  return true;
+}
+
+bool cal::EventSim::receiveScenario(EventQueue& uartRx) {
+  uint8_t byte = 0;
+
+  // wait as long as it takes for a scenario to start
+  bool started = false;
+  while (!started) {
+    readByte(uartRx, TIME_INFINITE, byte);
+    if (byte == 'S' && readByte(uartRx, kByteTimeout, byte)) {
+      started = byte == 'C';
+    }
+  }
+
+  uint8_t header[2];
+  for (uint8_t& b : header) {
+    if (!readByte(uartRx, kByteTimeout, b)) {
+      return false;
+    }
+  }
+  size_t count = header[0] | (header[1] << 8);
+  if (count > kMaxScenarioEvents) {
+    return false;
+  }
+
+  uint8_t buf[kRecordSize];
+  for (size_t i = 0; i < count; i++) {
+    for (uint8_t& b : buf) {
+      if (!readByte(uartRx, kByteTimeout, b)) {
+        return false;
+      }
+    }
+    m_scenario[i].timeUs = static_cast<uint32_t>(buf[0])
+        | (static_cast<uint32_t>(buf[1]) << 8)
+        | (static_cast<uint32_t>(buf[2]) << 16)
+        | (static_cast<uint32_t>(buf[3]) << 24);
+    m_scenario[i].event = Event::deserialize(buf + 4);
+  }
+
+  m_scenarioLength = count;
+  return true;
+}
+
+bool cal::EventSim::readByte(EventQueue& uartRx, systime_t timeout,
+    uint8_t& byte) {
+  while (uartRx.wait(timeout)) {
+    Event e = uartRx.pop();
+    if (e.type() == Event::Type::kUartRx) {
+      byte = static_cast<uint8_t>(e.getByte());
+      return true;
+    }
+  }
+
+  return false;
+}
 
 /**
- * @brief For now, perform the test itself by calling the function, notifying of
- *        test progress and success/failure over provided UART interface
+ * @note Deadlines are computed from the start of the replay rather than the
+ *       previous event, so timer latency doesn't accumulate. Resolution is
+ *       one system tick (CH_CFG_ST_FREQUENCY), offsets that are already due
+ *       fire on the next tick.
  */
-void cal::EventSim::registerTest(std::string name,
-    std::function<bool(EventQueue&, EventQueue&)> test) {
-  // log test start
-  m_uart.send(std::string("EventSim: Beginning test [") + name
-      + std::string("].\n"));
+void cal::EventSim::scheduleNextI() {
+  if (m_replayIndex >= m_scenarioLength) {
+    return;
+  }
+
+  systime_t deadline = m_replayStart
+      + US2ST(m_scenario[m_replayIndex].timeUs);
+  systime_t delay = deadline - chVTGetSystemTimeX();
+  // already due (or passed, which shows up as a wrapped, huge delay)
+  if (delay == 0 || delay > US2ST(m_scenario[m_replayIndex].timeUs)) {
+    delay = 1;
+  }
+
+  chVTSetI(&m_replayTimer, delay, &cal::EventSim::replayCallback, this);
+}
+
+void cal::EventSim::replayCallback(void *arg) {
+  cal::EventSim *_this = static_cast<cal::EventSim *>(arg);
+  size_t i = _this->m_replayIndex;
+
+  _this->m_injectedUs[i] = _this->elapsedUs();
+  // produced now, not when the scenario was parsed
+  _this->m_scenario[i].event.stamp();
+  // same as other driver callbacks, can't block on the consumer's queue
+  if (!_this->m_testConsumer.tryPush(_this->m_scenario[i].event)) {
+    _this->m_droppedInjections++;
+  }
+
+  chSysLockFromISR();
+  _this->m_replayIndex = i + 1;
+  _this->scheduleNextI();
+  chSysUnlockFromISR();
+}
+
+/**
+ * @note Timed with cal::Clock, which keeps counting while the core sleeps in
+ *       WFI (the cycle counter doesn't), so replays are limited to its wrap
+ *       period (~51 s)
+ */
+uint32_t cal::EventSim::elapsedUs() const {
+  return cal::Clock::elapsedUs(m_replayStartTime);
+}
+
+/**
+ * @brief Send the captured responses, then a summary with the reaction
+ *        latency (time from the latest injected event to each response)
+ */
+void cal::EventSim::reportScenario() {
+  uint8_t header[] = {'R', 'S', static_cast<uint8_t>(m_responseCount & 0xFF),
+    static_cast<uint8_t>(m_responseCount >> 8)};
+  m_uart.write(reinterpret_cast<const char *>(header), sizeof(header));
+  for (size_t i = 0; i < m_responseCount; i++) {
+    sendRecord(m_responses[i]);
+  }
+
+  uint32_t maxLatencyUs = 0;
+  uint32_t totalLatencyUs = 0;
+  size_t injected = 0;
+  for (size_t i = 0; i < m_responseCount; i++) {
+    // find the latest event injected before this response
+    while (injected < m_scenarioLength
+        && m_injectedUs[injected] <= m_responses[i].timeUs) {
+      injected++;
+    }
+    if (injected == 0) {
+      continue;
+    }
+
+    uint32_t latency = m_responses[i].timeUs - m_injectedUs[injected - 1];
+    totalLatencyUs += latency;
+    if (latency > maxLatencyUs) {
+      maxLatencyUs = latency;
+    }
+  }
+
+  ReportLine line;
+  line << "\nEventSim: Scenario replayed [" << m_scenarioLength
+      << "] events with [" << m_responseCount << "] responses.\n";
+  m_uart.send(line);
+
+  line.clear();
+  line << "EventSim: Reaction latency avg ["
+      << (m_responseCount > 0 ? totalLatencyUs / m_responseCount : 0)
+      << "] us, max [" << maxLatencyUs << "] us, [" << m_droppedInjections
+      << "] injections dropped.\n";
+  m_uart.send(line);
+}
+
+void cal::EventSim::sendRecord(Record& record) {
+  uint8_t buf[kRecordSize];
+
+  for (size_t b = 0; b < 4; b++) {
+    buf[b] = static_cast<uint8_t>(record.timeUs >> (8*b));
+  }
+  record.event.serialize(buf + 4);
+
+  // waits for TX space, back-to-back records can outpace the wire
+  m_uart.write(reinterpret_cast<const char *>(buf), kRecordSize);
+}
+
+uint32_t cal::EventSim::runStress(const StressConfig& config) {
+  ReportLine line;
+  line << "EventSim: Beginning stress test at [" << config.startRate
+      << "] events/s.\n";
+  m_uart.send(line);
+
+  uint32_t maxSustainableRate = 0;
+  uint32_t rate = config.startRate;
+  while (rate > 0 && rate <= config.maxRate) {
+    StressResult result = runStressStep(config, rate);
+    reportStressStep(result);
+
+    if (result.dropped > 0) {
+      break;
+    }
+    // the generator may not keep up with the target rate, so credit the
+    // consumer with the rate it actually sustained
+    maxSustainableRate = result.achievedRate;
+
+    rate += rate * config.rampPercent / 100;
+  }
+
+  line.clear();
+  line << "EventSim: Max sustainable rate [" << maxSustainableRate
+      << "] events/s.\n";
+  m_uart.send(line);
+  return maxSustainableRate;
+}
+
+cal::EventSim::StressResult cal::EventSim::runStressStep(
+    const StressConfig& config, uint32_t rate) {
+  StressResult result;
+  result.targetRate = rate;
+
+  // drop stale responses, and start the step's statistics from scratch
+  Event stale;
+  while (m_receiveQueue.tryPop(stale)) {
+    stale.releasePayload();
+  }
+  m_testConsumer.resetStats();
+
+  chSysLock();
+  m_stressRate = rate;
+  m_stressTarget = config.eventsPerStep;
+  m_stressInjected = 0;
+  m_stressDuration = 0;
+  m_stressStart = chVTGetSystemTimeX();
+  chVTSetI(&m_stressTimer, 1, &cal::EventSim::stressCallback, this);
+  chSysUnlock();
+
+  // match responses to their injection times by tag, until every event was
+  // injected and the consumer has been quiet for a while
+  while (true) {
+    if (m_receiveQueue.wait(kQuietTimeout)) {
+      Event e = m_receiveQueue.pop();
+      uint32_t latencyUs = cal::Clock::elapsedUs(
+          m_stressInjectedTimes[e.tag() % kStressWindow]);
+
+      size_t bucket = latencyUs == 0 ? 0 : 32 - __builtin_clz(latencyUs);
+      if (bucket >= kLatencyBuckets) {
+        bucket = kLatencyBuckets - 1;
+      }
+      result.latencyHistogram[bucket]++;
+      if (latencyUs > result.maxLatencyUs) {
+        result.maxLatencyUs = latencyUs;
+      }
+      result.received++;
+    } else if (m_stressInjected >= m_stressTarget) {
+      break;
+    }
+  }
+
+  result.injected = m_stressInjected;
+  result.dropped = result.injected > result.received
+      ? result.injected - result.received : 0;
+  result.consumerHighWater = m_testConsumer.highWater();
+  result.consumerOverflows = m_testConsumer.overflows();
+  result.failedInjections = m_testConsumer.failedPushes();
+  result.achievedRate = static_cast<uint32_t>(
+      static_cast<uint64_t>(result.injected) * CH_CFG_ST_FREQUENCY
+      / (m_stressDuration > 0 ? m_stressDuration : 1));
+
+  return result;
+}
+
+/**
+ * @note Cycles through the event types the consumer would see from drivers.
+ *       Digital input transitions are left out, the FSM logs each one.
+ */
+Event cal::EventSim::stressEvent(uint16_t seq) {
+  Event e;
+  switch (seq % 3) {
+    case 0:
+      e = Event(Event::Type::kUartRx, static_cast<char>(seq));
+      break;
+    case 1:
+      e = Event(Event::Type::kAdcConversion, Gpio::kA1, seq);
+      break;
+    default:
+      e = Event(Event::Type::kCanRx, seq, {seq, 0, 0, 0, 0, 0, 0, 0});
+      break;
+  }
+
+  e.setTag(seq);
+  return e;
+}
+
+/**
+ * @note Events due since the start of the step are injected in bursts each
+ *       tick, so rates above CH_CFG_ST_FREQUENCY are reachable. Bursts are
+ *       capped at kMaxStressBurst, past that the generator falls behind and
+ *       the achieved rate drops below the target.
+ */
+void cal::EventSim::stressCallback(void *arg) {
+  cal::EventSim *_this = static_cast<cal::EventSim *>(arg);
+
+  systime_t elapsed = chVTTimeElapsedSinceX(_this->m_stressStart);
+  uint64_t due = static_cast<uint64_t>(_this->m_stressRate) * elapsed
+      / CH_CFG_ST_FREQUENCY;
+  if (due > _this->m_stressTarget) {
+    due = _this->m_stressTarget;
+  }
+
+  uint32_t injected = _this->m_stressInjected;
+  for (uint32_t burst = 0; injected < due && burst < kMaxStressBurst;
+      burst++) {
+    uint16_t seq = static_cast<uint16_t>(injected);
+    _this->m_stressInjectedTimes[seq % kStressWindow] = cal::Clock::now32();
+    // failures are counted by the queue
+    _this->m_testConsumer.tryPush(stressEvent(seq));
+    injected++;
+  }
+
+  chSysLockFromISR();
+  _this->m_stressInjected = injected;
+  if (injected < _this->m_stressTarget) {
+    chVTSetI(&_this->m_stressTimer, 1, &cal::EventSim::stressCallback, _this);
+  } else {
+    _this->m_stressDuration = elapsed;
+  }
+  chSysUnlockFromISR();
+}
 
-  // run the test
-  bool result = test(m_testConsumer, m_receiveQueue);
+void cal::EventSim::reportStressStep(StressResult& result) {
+  ReportLine line;
+  line << "EventSim: Stress rate [" << result.targetRate
+      << "] events/s (achieved [" << result.achievedRate << "]), received ["
+      << result.received << "/" << result.injected << "], dropped ["
+      << result.dropped << "].\n";
+  m_uart.send(line);
 
-  std::string resultStr = result == true ? "SUCCESS" : "FAILURE";
+  line.clear();
+  line << "EventSim: Consumer queue high-water [" << result.consumerHighWater
+      << "], overflows [" << result.consumerOverflows
+      << "], failed injections [" << result.failedInjections
+      << "], max latency [" << result.maxLatencyUs << "] us.\n";
+  m_uart.send(line);
 
-  // log test end
-  m_uart.send(std::string("EventSim: Ending test    [") + name
-      + std::string("] with ") + resultStr + std::string(".\n"));
+  // histogram as "<upper bound us>:<count>" pairs, skipping empty buckets
+  line.clear();
+  line << "EventSim: Latency histogram [";
+  for (size_t i = 0; i < kLatencyBuckets; i++) {
+    if (result.latencyHistogram[i] == 0) {
+      continue;
+    }
+    if (i < kLatencyBuckets - 1) {
+      line << "<" << (1u << i);
+    } else {
+      line << ">=" << (1u << (i - 1));
+    }
+    line << ":" << result.latencyHistogram[i] << " ";
+  }
+  line << "] us.\n";
+  m_uart.send(line);
 }
@@ -4,26 +4,126 @@
 
 #include <mutex>
 #include <vector>
-#include <string>
 
 // @TODO finish the chibios-subsys common header that includes all (cal.hpp)
 #include "../../cal.h"
 #include "../uart/Uart.h"
+#include "../thread/Thread.h"
 #include "../../common/Gpio.h"
 #include "../../common/Event.h"
 #include "../../common/EventQueue.h"
 #include "../../common/CircularBuffer.h"
+#include "../../common/Delegate.h"
+#include "../../common/FixedString.h"
 #include "ch.h"
 #include "hal.h"
 
 namespace cal {
 
+/**
+ * Event simulator, injecting events into a test consumer (e.g. the FSM) and
+ * capturing the events it sends back.
+ *
+ * Registered tests are run by runTests(), concurrently where possible: tests
+ * against different consumers each run on their own worker thread, with their
+ * own receive queue, while tests sharing a consumer run one after another on
+ * the same worker. Results are reported as tests finish.
+ *
+ * Besides running registered test functions, the simulator replays scenarios
+ * received over UART. A scenario is a compact binary stream of timestamped
+ * events (all integers little-endian):
+ *
+ *   'S' 'C' <uint16 count> count * { <uint32 offset us> <Event, 21 bytes> }
+ *
+ * where each offset is relative to the start of the replay, and the events
+ * use Event::serialize's format. The events are injected into the test
+ * consumer's queue from a virtual timer at their offsets, while the consumer's
+ * responses are captured from the receive queue with timestamps. Once the
+ * consumer goes quiet the responses are sent back over UART as:
+ *
+ *   'R' 'S' <uint16 count> count * { <uint32 time us> <Event, 21 bytes> }
+ *
+ * followed by a text summary with the consumer's reaction latency.
+ *
+ * The stress mode load-tests the test consumer instead: it injects a mix of
+ * synthetic events at a target rate, ramping the rate up each step until
+ * events are lost, and reports each step's latency histogram, queue high-water
+ * mark and drops. The consumer must send back every event it receives
+ * (preserving Event::tag) for the round trips to be matched.
+ *
+ * @note Times are taken with cal::Clock, which must be started
+ */
 class EventSim {
  public:
+  // Max number of events in a scenario, and of responses captured per replay
+  static constexpr size_t kMaxScenarioEvents = 16;
+  static constexpr size_t kMaxResponses = 16;
+
+  // Size of one timestamped event in scenario and response streams
+  static constexpr size_t kRecordSize = 4 + Event::kSerializedSize;
+
+  // Max time between two bytes of a scenario before it is discarded
+  static constexpr systime_t kByteTimeout = MS2ST(100);
+
+  // Time without responses after the last injected event that ends a replay
+  static constexpr systime_t kQuietTimeout = MS2ST(100);
+
+  // Number of in-flight stress events whose injection times are tracked,
+  // responses that lag further behind get matched to the wrong event
+  static constexpr size_t kStressWindow = 256;
+
+  // Max events injected per system tick, bounds the time spent in the
+  // generator's timer callback
+  static constexpr uint32_t kMaxStressBurst = 32;
+
+  // Latency histogram buckets, bucket i counts latencies in [2^(i-1), 2^i) us
+  // (bucket 0 is < 1 us and the last bucket is open-ended)
+  static constexpr size_t kLatencyBuckets = 16;
+
+  // Max number of registered tests, and so of worker threads
+  static constexpr size_t kMaxTests = 4;
+
+  // Bytes of stack for each test worker thread
+  static constexpr size_t kTestStackSize = 768;
+
+  // Test body, a plain function or a bound cal::Delegate (never allocates)
+  using TestFunc = cal::Delegate<bool(EventQueue&, EventQueue&)>;
+
+  struct StressConfig {
+    // event rate of the first step, in events/s
+    uint32_t startRate = 1000;
+
+    // the ramp stops at this rate even without drops
+    uint32_t maxRate = 200000;
+
+    // rate increase between steps, in percent
+    uint32_t rampPercent = 50;
+
+    // events injected per step
+    uint32_t eventsPerStep = 2000;
+  };
+
+  struct StressResult {
+    // target and achieved event rates, in events/s
+    uint32_t targetRate = 0;
+    uint32_t achievedRate = 0;
+
+    uint32_t injected = 0;
+    uint32_t received = 0;
+
+    // events that never came back, for whatever reason
+    uint32_t dropped = 0;
+
+    // test consumer queue statistics
+    size_t consumerHighWater = 0;
+    uint32_t consumerOverflows = 0;
+    uint32_t failedInjections = 0;
+
+    uint32_t maxLatencyUs = 0;
+    std::array<uint32_t, kLatencyBuckets> latencyHistogram = {};
+  };
+
   /**
-   * @TODO After initial proof of concept with internal test generation, the
-   *       provided UART interface may be used to receive simulated events
-   *       externally
    * @TODO In all modules abstracted in the future, make them purely event
    *       driven and isolated. Then make them transmit their responses to the
    *       event queue of the module that sent them the request
@@ -34,10 +134,126 @@ class EventSim {
    */
   EventSim(cal::Uart& uart, EventQueue& testConsumer);
 
-  void registerTest(std::string name,
-      std::function<bool(EventQueue&, EventQueue&)> test);
+  /**
+   * @brief Register a test against the simulator's test consumer, receiving
+   *        its responses on receiveQueue()
+   * @param name Name results are reported under, must outlive the simulator
+   *        (e.g. a string literal)
+   * @return False if kMaxTests are already registered, the test is
+   *         reported over UART and not run
+   * @note Tests are run by runTests()
+   */
+  bool registerTest(const char *name, TestFunc test);
+
+  /**
+   * @brief Register a test against its own consumer, so it can run
+   *        concurrently with tests against other consumers
+   * @return Queue the test's consumer should send its responses to, nullptr
+   *         if kMaxTests are already registered (reported over UART)
+   */
+  EventQueue *registerTest(const char *name, EventQueue& testConsumer,
+      TestFunc test);
+
+  /**
+   * @brief Run every registered test, reporting each result over UART as it
+   *        finishes, then the suite's wall time
+   * @return True if every test passed
+   */
+  bool runTests();
+
+  /**
+   * @brief Receive a scenario, replay it into the test consumer and report
+   *        the captured responses over UART. Blocks until a scenario starts.
+   * @param uartRx Queue the Uart pushes its kUartRx events to
+   * @return True if a complete scenario was received and replayed
+   */
+  bool runScenario(EventQueue& uartRx);
+
+  /**
+   * @brief Ramp the injected event rate until the test consumer drops
+   *        events, reporting every step over UART
+   * @return Max sustainable rate in events/s, i.e. the highest rate of a step
+   *         without drops (0 if even the first step dropped events)
+   */
+  uint32_t runStress(const StressConfig& config);
+
+  // @brief Inject config.eventsPerStep events at the given rate, and wait for
+  //        the test consumer to send them back
+  StressResult runStressStep(const StressConfig& config, uint32_t rate);
+
+  // @return Queue the test consumer should send its responses to
+  EventQueue& receiveQueue();
 
  private:
+  // report lines are composed without the heap, and fit in one send()
+  using ReportLine = cal::FixedString<cal::Uart::kMaxMsgLen - 1>;
+
+  struct Record {
+    // offset from the start of the replay
+    uint32_t timeUs;
+    Event event;
+  };
+
+  struct Test {
+    const char *name = "";
+    TestFunc func;
+    EventQueue *consumer = nullptr;
+    EventQueue *monitor = nullptr;
+
+    // worker thread the test runs on, one per distinct consumer
+    size_t worker = 0;
+
+    bool result = false;
+    systime_t duration = 0;
+  };
+
+  struct TestWorker {
+    cal::Thread<kTestStackSize> thread{"EventSim Test"};
+
+    // signaled by runTests() to run the worker's tests once
+    binary_semaphore_t go;
+
+    EventSim *sim = nullptr;
+    size_t index = 0;
+
+    // @brief Thread function, runs the worker's tests each time it's signaled
+    void run();
+  };
+
+  // @return The test's slot, nullptr if every slot is taken
+  Test *addTest(const char *name, EventQueue& testConsumer, TestFunc test);
+
+  // @brief Run the tests assigned to a worker, called on that worker's thread
+  void runWorkerTests(size_t worker);
+
+  // @brief Parse a scenario from the UART RX event stream into m_scenario
+  bool receiveScenario(EventQueue& uartRx);
+
+  // @brief Pop the next received byte, skipping non-UART events
+  static bool readByte(EventQueue& uartRx, systime_t timeout, uint8_t& byte);
+
+  // @brief Arm the replay timer for the next scenario event
+  //        (called with the kernel locked)
+  void scheduleNextI();
+
+  // @brief Injects the next scenario event, fires at its offset
+  static void replayCallback(void *arg);
+
+  // @return Microseconds since the current replay started
+  uint32_t elapsedUs() const;
+
+  void reportScenario();
+  void sendRecord(Record& record);
+
+  // @brief Synthetic event number seq of a stress step, tagged with seq
+  static Event stressEvent(uint16_t seq);
+
+  // @brief Inject the stress events due by now, fires every system tick
+  static void stressCallback(void *arg);
+
+  void reportStressStep(StressResult& result);
+
+
   // interface to log over (and possibly receive test conditions from in the
   // future)
   cal::Uart& m_uart;
@@ -46,7 +262,49 @@ class EventSim {
   EventQueue& m_testConsumer;
 
   // evnet queue to receive events back from test consumer(s)
-  EventQueue m_receiveQueue;
+  cal::MutexEventQueue m_receiveQueue;
+
+  // registered tests, and receive queues of tests with their own consumer
+  std::array<Test, kMaxTests> m_tests;
+  std::array<cal::MutexEventQueue, kMaxTests> m_testMonitors;
+  size_t m_testCount = 0;
+
+  std::array<TestWorker, kMaxTests> m_workers;
+  size_t m_workerCount = 0;
+
+  // indices of finished tests in the order they finished, each one signals
+  // m_testsDone
+  std::array<size_t, kMaxTests> m_finished;
+  size_t m_finishedCount = 0;
+  semaphore_t m_testsDone;
+
+  // scenario being replayed, and the responses captured during the replay
+  std::array<Record, kMaxScenarioEvents> m_scenario;
+  size_t m_scenarioLength = 0;
+  std::array<Record, kMaxResponses> m_responses;
+  size_t m_responseCount = 0;
+
+  // actual injection times of the scenario events
+  std::array<uint32_t, kMaxScenarioEvents> m_injectedUs = {};
+
+  // replay state, written by the timer callback
+  virtual_timer_t m_replayTimer;
+  volatile size_t m_replayIndex = 0;
+  systime_t m_replayStart = 0;
+  // cal::Clock::now32() at the replay's start
+  uint32_t m_replayStartTime = 0;
+  uint32_t m_droppedInjections = 0;
+
+  // stress generator state, written by the timer callback
+  virtual_timer_t m_stressTimer;
+  systime_t m_stressStart = 0;
+  uint32_t m_stressRate = 0;
+  uint32_t m_stressTarget = 0;
+  volatile uint32_t m_stressInjected = 0;
+  // time taken to inject every event of the step
+  volatile systime_t m_stressDuration = 0;
+  // cal::Clock::now32() at each injection, by sequence number
+  std::array<uint32_t, kStressWindow> m_stressInjectedTimes = {};
 };
 
 }
@@ -6,80 +6,153 @@
 // @TODO fix include dirs w/ local Makefile
 //#include "../../../cal.h"
 #include "../../uart/Uart.h"
+#include "../../digital-in/DigitalIn.h"
+#include "../../profiler/CpuLoad.h"
+#include "../../profiler/KernelProfiler.h"
+#include "../../profiler/LatencyReport.h"
+#include "../../shell/StatsShell.h"
+#include "../../thread/ActiveObject.h"
+#include "../../thread/TaskScheduler.h"
+#include "../../thread/Thread.h"
+#include "../../timer/TimerService.h"
 #include "../EventSim.h"
+#include "../../../common/Clock.h"
 #include "../../../common/Event.h"
 #include "../../../common/EventQueue.h"
+#include "../../../common/EventTrace.h"
+#include "../../../common/Histogram.h"
+#include "../../../common/Task.h"
+#include "../../../common/Stats.h"
 #include "ch.hpp"
 #include "hal.h"
 #include "pinconf.h"
 
-//static THD_WORKING_AREA(timer1Wa, 128);
-//static THD_FUNCTION(timer1Func, arg) {
-//  chRegSetThreadName("Timer 1");
-//
-//  cal::Uart* uart = static_cast<cal::Uart*>(arg);
-//
-//  while (true) {
-//    uart->send("Timer 1 still alive...\n");
-//    chThdSleepMilliseconds(500);
-//  }
-//}
-//
-//static THD_WORKING_AREA(timer2Wa, 128);
-//static THD_FUNCTION(timer2Func, arg) {
-//  chRegSetThreadName("Timer 2");
-//
-//  cal::Uart* uart = static_cast<cal::Uart*>(arg);
-//
-//  while (true) {
-//    uart->send("Timer 2 still alive...\n");
-//    chThdSleepMilliseconds(2000);
-//  }
-//}
-
 /**
+ * @brief The FSM under test, set up as another module receiving and sending
+ *        events like any other
  *
- *
- *
- *
- *
- *
- *
- *
- * MAIN TODO
- *  Setup the FSM as another module receiving and sending events like any other.
- *  This will facilitate testing and improve robustness of other processes. May
- *  require incorporation of threading abstactions -- leave these for later
- *
- *
- *
- *
- *
- *
+ * @note Replies to every event by sending it back to the monitor (the
+ *       EventSim's receive queue), and reports debounced button transitions.
+ *       Timer events are its heartbeat, they're logged instead of echoed so
+ *       they don't show up in test replies.
  */
+class EchoFsm : public cal::ActiveObject<512> {
+ public:
+  explicit EchoFsm(const char *name) : cal::ActiveObject<512>(name) {}
+
+  // @brief Begin dispatching, replying to the monitor and logging over the
+  //        provided UART interface
+  void start(cal::Uart& uart, EventQueue& monitor) {
+    m_uart = &uart;
+    m_monitor = &monitor;
+    cal::ActiveObject<512>::start();
+  }
+
+ private:
+  void handle(Event& e) override {
+    if (e.type() == Event::Type::kDigInTransition) {
+      // report each settled edge once, chatter never reaches the queue
+      m_uart->send(e.digInState() ? "Button high @ " : "Button low @ ");
+      m_uart->send(static_cast<int>(e.digInTime()));
+      m_uart->send('\n');
+    }
+
+    if (e.type() == Event::Type::kTimerTimeout) {
+      m_uart->send(thread().name());
+      m_uart->send(" still alive...\n");
+      return;
+    }
+
+    e.retainPayload();
+    m_monitor->push(e);
+  }
+
+  cal::Uart *m_uart = nullptr;
+  EventQueue *m_monitor = nullptr;
+};
+
+static EchoFsm fsm("FSM");
+
+// a second, independent consumer, so tests against it run concurrently with
+// tests against the FSM
+static EchoFsm echo("Echo");
+
+// receives the UART's RX bytes, which carry EventSim scenarios
+static cal::CriticalSectionEventQueue uartRxQueue;
+
+// reads stats on command, forwarding every RX byte to uartRxQueue
+static cal::StatsShell shell("Shell");
 
 bool simpleTest(EventQueue& testConsumer, EventQueue& testMonitor) {
-  // basic synchronous test
-  palSetPad(STARTUP_LED_PORT, STARTUP_LED_PIN);
-  chThdSleepMilliseconds(50);
-  palSetPad(STARTUP_LED_PORT, STARTUP_LED_PIN);
-  chThdSleepMilliseconds(50);
+  // send an event to the FSM then wait to hear back
+  testConsumer.push(Event(Event::Type::kUartRx, 'a'));
 
-  // TODO send an event to the FSM then wait to hear back and report the test
-  //      result
+  if (!testMonitor.wait(MS2ST(100))) {
+    return false;
+  }
 
-  return true;
+  Event reply = testMonitor.pop();
+  return reply.type() == Event::Type::kUartRx && reply.getByte() == 'a';
 }
 
-static THD_WORKING_AREA(testerWa, 128);
-static THD_FUNCTION(testerFunc, arg) {
-  chRegSetThreadName("Tester");
+// everything the FSM receives, streamed over UART in the background
+static cal::EventTrace fsmTrace;
+
+// push-to-pop latency of the FSM's events, and send-to-txEmpty latency
+static cal::Histogram fsmLatency;
+static cal::Histogram uartTxLatency;
+
+/**
+ * @brief Streams the FSM's trace using only TX bandwidth nothing else needs
+ *
+ * @note A task rather than a thread, so it shares the stack of the other
+ *       background tasks. State that lives across awaits is in members.
+ */
+class TraceStreamer : public cal::Task {
+ public:
+  explicit TraceStreamer(cal::Uart& uart) : m_uart(uart) {}
+
+ private:
+  Status run() override {
+    CAL_TASK_BEGIN();
+    while (true) {
+      while (fsmTrace.size() > 0) {
+        CAL_TASK_AWAIT(m_uart.txFree() >= sizeof(m_batch));
+        m_ticket = m_uart.sendAsync(reinterpret_cast<const char *>(m_batch),
+            fsmTrace.read(m_batch, sizeof(m_batch)));
+        // one batch at a time, so the trace never crowds out other output
+        CAL_TASK_AWAIT(m_uart.txDone(m_ticket));
+      }
+      // the trace doesn't wake the scheduler, check back for new records
+      CAL_TASK_SLEEP(MS2ST(10));
+    }
+    CAL_TASK_END();
+  }
+
+  cal::Uart& m_uart;
+  uint32_t m_ticket = 0;
+
+  // largest batch the UART accepts in one send
+  uint8_t m_batch[cal::Uart::kMaxMsgLen - 1];
+};
 
+// background tasks, all on one low priority thread
+static cal::TaskScheduler<512, LOWPRIO + 1> backgroundTasks("Tasks");
+
+static cal::Thread<1024> tester("Tester");
+static THD_FUNCTION(testerFunc, arg) {
   cal::EventSim* eventSimulator = static_cast<cal::EventSim*>(arg);
 
-  // register tests
-  // @note Currently these must be run synchronously
-  eventSimulator->registerTest("Simple Test", simpleTest);
+  // run the tests registered in main, each consumer on its own worker
+  eventSimulator->runTests();
+
+  // find the FSM's max sustainable event rate
+  eventSimulator->runStress(cal::EventSim::StressConfig());
+
+  // then replay every scenario received over UART
+  while (true) {
+    eventSimulator->runScenario(uartRxQueue);
+  }
 }
 
 int main() {
@@ -93,6 +166,13 @@ int main() {
   halInit();
   chSysInit();
 
+  // account CPU time from here on, via the chconf.h hooks
+  cal::KernelProfiler::start();
+  cal::CpuLoad::start();
+
+  // timestamps for events
+  cal::Clock::start();
+
   // Pin initialization
   // UART TX/RX
   // TODO: Change to #def'd vars
@@ -107,10 +187,17 @@ int main() {
   // Init LED states to LOW
   palClearPad(STARTUP_LED_PORT, STARTUP_LED_PIN);
 
-  EventQueue fsmEventQueue = EventQueue();
+  EventQueue& fsmEventQueue = fsm.queue();
 
   // setup a UART interface to immediately begin transmitting and receiving
-  cal::Uart uart = cal::Uart(UartInterface::kD3, fsmEventQueue);
+  cal::Uart uart(UartInterface::kD3, shell.queue());
+  // diagnostic prints from any thread go to the TX ring, never the wire
+  uart.routePrintf();
+  shell.start(uart, &uartRxQueue);
+
+  // debounced drive mode button, transitions are reported by the FSM
+  cal::DigitalIn driveModeButton(DigitalInput::kDriveModeButton,
+      fsmEventQueue);
 
   // test async UART transmit
   uart.send("Starting event simulator\n");
@@ -121,20 +208,52 @@ int main() {
   //       is busy. On inspection, the UART output simply reset afte spurious
   //       restarts causing incomplete messages and garbled bytes.
 
-  // create some timer threads to test mult-thread access (note that at
-  // high-frequency and serial throughput these should produce race conditions)
-  //chThdCreateStatic(timer1Wa, sizeof(timer1Wa), NORMALPRIO,
-  //    timer1Func, &uart);
-  //chThdCreateStatic(timer2Wa, sizeof(timer2Wa), NORMALPRIO,
-  //    timer2Func, &uart);
+  // heartbeats from timers instead of a sleeping thread (and stack) each
+  static cal::TimerService<8> timers;
+  timers.startPeriodic(fsmEventQueue, MS2ST(500));
+  timers.startPeriodic(echo.queue(), MS2ST(2000));
 
   // create the tester
-  cal::EventSim eventSimulator = cal::EventSim(uart, fsmEventQueue);
+  // @note Static, its scenario buffers don't fit on the main stack
+  static cal::EventSim eventSimulator(uart, fsmEventQueue);
+
+  // register tests, then start the consumers once their reply queues exist.
+  // Tests that don't fit are reported by the simulator, an untested echo
+  // object replies to the simulator's own queue.
+  bool registered = eventSimulator.registerTest("Simple Test", simpleTest);
+  EventQueue *echoMonitor = eventSimulator.registerTest("Echo Test",
+      echo.queue(), simpleTest);
+  registered = registered && echoMonitor != nullptr;
+
+  fsm.start(uart, eventSimulator.receiveQueue());
+  echo.start(uart, echoMonitor != nullptr ? *echoMonitor
+                                          : eventSimulator.receiveQueue());
+
+  // trace the FSM's queue for replay on the host
+  fsmEventQueue.setTrace(&fsmTrace, 1);
+  static TraceStreamer traceStreamer(uart);
+  backgroundTasks.add(traceStreamer);
+
+  // resume background tasks when the UART frees up TX space
+  uart.setTxHook(backgroundTasks.waker());
+  backgroundTasks.start();
+
+  // latency tails of the hot paths, reported with the CPU load
+  fsmEventQueue.setLatencyHistogram(&fsmLatency);
+  uart.setTxLatencyHistogram(&uartTxLatency);
+
+  // everything "stats" lists in the shell
+  fsmEventQueue.registerStats("fsm");
+  fsmEventQueue.registerOverflowStats("fsm");
+  echo.queue().registerStats("echo");
+  uartRxQueue.registerStats("uartRx");
+  uart.registerStats("uart");
+  timers.registerStats("timers");
+  cal::Stats::addAllocatorStats("alloc");
 
   // @note Test thread until implementing thread abstraction for things that
   //       can't be implemented with ChibiOS callbacks
-  chThdCreateStatic(testerWa, sizeof(testerWa), NORMALPRIO,
-      testerFunc, &eventSimulator);
+  tester.start(testerFunc, &eventSimulator);
 
   // Indicate startup - blink then stay on
   for (uint8_t i = 0; i < 5; i++) {
@@ -144,26 +263,28 @@ int main() {
     chThdSleepMilliseconds(50);
   }
 
-  palClearPad(STARTUP_LED_PORT, STARTUP_LED_PIN);
+  // stays lit if a test wasn't registered (the simulator reported which)
+  if (registered) {
+    palClearPad(STARTUP_LED_PORT, STARTUP_LED_PIN);
+  } else {
+    palSetPad(STARTUP_LED_PORT, STARTUP_LED_PIN);
+  }
   chThdSleepMilliseconds(300);
 
-  while (1) {
-    // always deplete the queue to help ensure that events are
-    // processed faster than they're generated
-    while (fsmEventQueue.size() > 0) {
-      Event e = fsmEventQueue.pop();
-
-      if (e.type() == Event::Type::kUartRx) {
-        // send received byte back to source (test throughput)
-        uart.send((char)e.getByte());
-      }
-    }
+  // report how much of each thread's stack the tests actually used
+  cal::ThreadBase::reportStacks(uart);
 
-    // TODO: use condition var to signal that events are present in the queue
-    chThdSleepMilliseconds(
-        1);  // must be fast enough to deplete event queue quickly enough
-  }
+  // report the FSM's worst-case run-to-completion time
+  uart.send("FSM max dispatch cycles: ");
+  uart.send(static_cast<int>(fsm.maxDispatchCycles()));
+  uart.send('\n');
 
-  // sleep forever
-  chThdSleepMilliseconds(1000*60*60*24);
+  // the FSM thread does all the work from here on, report what it costs
+  while (1) {
+    chThdSleepMilliseconds(5000);
+    cal::KernelProfiler::report(uart);
+    cal::CpuLoad::report(uart);
+    cal::LatencyReport::report(uart, "FSM queue", fsmLatency);
+    cal::LatencyReport::report(uart, "UART TX", uartTxLatency);
+  }
 }
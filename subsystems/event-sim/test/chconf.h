@@ -385,7 +385,7 @@
  *
  * @note    The default is @p FALSE.
  */
-#define CH_DBG_FILL_THREADS                 FALSE
+#define CH_DBG_FILL_THREADS                 TRUE
 
 /**
  * @brief   Debug option, threads profiling.
@@ -407,12 +407,21 @@
  */
 /*===========================================================================*/
 
+/*
+ * @note The hooks below feed cal::KernelProfiler (chibios-subsys profiler
+ *       subsystem)
+ */
+#if !defined(_FROM_ASM_)
+#include "KernelProfilerHooks.h"
+#endif
+
 /**
  * @brief   Threads descriptor structure extension.
  * @details User fields added to the end of the @p thread_t structure.
  */
 #define CH_CFG_THREAD_EXTRA_FIELDS                                          \
-  /* Add threads custom fields here.*/
+  /* Add threads custom fields here.*/                                      \
+  CAL_KERNEL_PROFILER_THREAD_FIELDS
 
 /**
  * @brief   Threads initialization hook.
@@ -423,6 +432,7 @@
  */
 #define CH_CFG_THREAD_INIT_HOOK(tp) {                                       \
   /* Add threads initialization code here.*/                                \
+  CAL_KERNEL_PROFILER_THREAD_INIT(tp);                                      \
 }
 
 /**
@@ -439,6 +449,7 @@
  */
 #define CH_CFG_CONTEXT_SWITCH_HOOK(ntp, otp) {                              \
   /* Context switch code here.*/                                            \
+  calProfilerContextSwitch(ntp, otp);                                       \
 }
 
 /**
@@ -446,6 +457,7 @@
  */
 #define CH_CFG_IRQ_PROLOGUE_HOOK() {                                        \
   /* IRQ prologue code here.*/                                              \
+  calProfilerIrqEnter();                                                    \
 }
 
 /**
@@ -453,6 +465,7 @@
  */
 #define CH_CFG_IRQ_EPILOGUE_HOOK() {                                        \
   /* IRQ epilogue code here.*/                                              \
+  calProfilerIrqExit();                                                     \
 }
 
 /**
@@ -463,6 +476,7 @@
  */
 #define CH_CFG_IDLE_ENTER_HOOK() {                                          \
   /* Idle-enter code here.*/                                                \
+  calLoadIdleEnter();                                                       \
 }
 
 /**
@@ -473,6 +487,7 @@
  */
 #define CH_CFG_IDLE_LEAVE_HOOK() {                                          \
   /* Idle-leave code here.*/                                                \
+  calLoadIdleLeave();                                                       \
 }
 
 /**
@@ -516,6 +531,12 @@
 /* Port-specific settings (override port settings defaulted in chcore.h).    */
 /*===========================================================================*/
 
+/*
+ * @note Sleep in the idle thread, cal::CpuLoad then measures idle time with
+ *       the system time since the cycle counter stops during WFI
+ */
+#define CORTEX_ENABLE_WFI_IDLE              TRUE
+
 #endif  /* CHCONF_H */
 
 /** @} */
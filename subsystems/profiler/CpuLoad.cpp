@@ -0,0 +1,67 @@
+#include "../../cal.h"
+#include "CpuLoad.h"
+
+#include "../uart/Uart.h"
+#include "../../common/FixedString.h"
+#include "../../common/LoadMeter.h"
+#include "KernelProfilerHooks.h"
+#include "ch.h"
+#include "hal.h"
+
+// Definitions for static members
+cal::LoadMeter cal::CpuLoad::meter;
+
+// C entry points for the kernel hooks
+void calLoadIdleEnter(void) { cal::CpuLoad::idleEnter(); }
+
+void calLoadIdleLeave(void) { cal::CpuLoad::idleLeave(); }
+
+void cal::CpuLoad::start() {
+  chSysLock();
+  meter = cal::LoadMeter(now());
+  chSysUnlock();
+}
+
+cal::CpuLoad::Report cal::CpuLoad::sample() {
+  chSysLock();
+  cal::LoadMeter::Sample s = meter.sample(now());
+  chSysUnlock();
+
+  Report r;
+  r.loadPermille = s.loadPermille;
+  r.windowUs = toUs(s.elapsed);
+  r.wakeupsPerSecond = r.windowUs == 0 ? 0 : static_cast<uint32_t>(
+      static_cast<uint64_t>(s.wakeups) * 1000000 / r.windowUs);
+  return r;
+}
+
+void cal::CpuLoad::report(cal::Uart& uart) {
+  Report r = sample();
+
+  cal::FixedString<cal::Uart::kMaxMsgLen - 1> line;
+  line << "CpuLoad: [" << r.loadPermille / 10 << "." << r.loadPermille % 10
+      << "]% busy, [" << r.wakeupsPerSecond << "] wakeups/s over ["
+      << r.windowUs / 1000 << "] ms.\n";
+  uart.send(line);
+}
+
+// @note Called from the idle hooks, within the kernel lock
+void cal::CpuLoad::idleEnter() { meter.idleEnter(now()); }
+
+void cal::CpuLoad::idleLeave() { meter.idleLeave(now()); }
+
+uint32_t cal::CpuLoad::now() {
+#if CORTEX_ENABLE_WFI_IDLE == TRUE
+  return chVTGetSystemTimeX();
+#else
+  return chSysGetRealtimeCounterX();
+#endif
+}
+
+uint32_t cal::CpuLoad::toUs(uint32_t duration) {
+#if CORTEX_ENABLE_WFI_IDLE == TRUE
+  return ST2US(duration);
+#else
+  return RTC2US(STM32_HCLK, duration);
+#endif
+}
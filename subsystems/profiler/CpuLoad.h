@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+
+// @TODO finish the chibios-subsys common header that includes all (cal.hpp)
+#include "../../cal.h"
+#include "../uart/Uart.h"
+#include "../../common/LoadMeter.h"
+#include "KernelProfilerHooks.h"
+#include "ch.h"
+#include "hal.h"
+
+namespace cal {
+
+/**
+ * @brief System-wide CPU load and wakeup rate, from the kernel's idle hooks
+ *
+ * A static cal::LoadMeter fed by CH_CFG_IDLE_ENTER_HOOK/CH_CFG_IDLE_LEAVE_HOOK
+ * (see KernelProfilerHooks.h). Each sample() covers the window since the
+ * previous one.
+ *
+ * @note With CORTEX_ENABLE_WFI_IDLE the core clock, and with it the cycle
+ *       counter, stops while idle, so the meter runs on the system time
+ *       instead (one tick resolution, CH_CFG_ST_FREQUENCY). Without WFI it
+ *       runs on the cycle counter.
+ */
+class CpuLoad {
+ public:
+  struct Report {
+    // share of the window spent busy, in 1/1000
+    uint32_t loadPermille;
+    uint32_t wakeupsPerSecond;
+    uint32_t windowUs;
+  };
+
+  // @brief Start the first window
+  static void start();
+
+  // @brief Close the current window and start a new one
+  static Report sample();
+
+  // @brief sample(), then log the window's load and wakeup rate
+  static void report(cal::Uart& uart);
+
+  // hook implementations, see KernelProfilerHooks.h
+  static void idleEnter();
+  static void idleLeave();
+
+ private:
+  // @return Current time in the meter's units
+  static uint32_t now();
+
+  // @return Microseconds in a duration of the meter's units
+  static uint32_t toUs(uint32_t duration);
+
+  static cal::LoadMeter meter;
+};
+
+}
@@ -0,0 +1,163 @@
+#include "../../cal.h"
+#include "KernelProfiler.h"
+
+#include "../uart/Uart.h"
+#include "../../common/FixedString.h"
+#include "KernelProfilerHooks.h"
+#include "ch.h"
+#include "hal.h"
+
+// Definitions for static members
+constexpr size_t cal::KernelProfiler::kMaxThreads;
+bool cal::KernelProfiler::running = false;
+rtcnt_t cal::KernelProfiler::windowStart = 0;
+rtcnt_t cal::KernelProfiler::sliceStart = 0;
+uint32_t cal::KernelProfiler::sliceIrqCycles = 0;
+uint32_t cal::KernelProfiler::irqNesting = 0;
+rtcnt_t cal::KernelProfiler::irqStart = 0;
+uint32_t cal::KernelProfiler::irqCycles = 0;
+uint32_t cal::KernelProfiler::irqCount = 0;
+uint32_t cal::KernelProfiler::maxIrqCycles = 0;
+uint32_t cal::KernelProfiler::switches = 0;
+
+// C entry points for the kernel hooks
+void calProfilerContextSwitch(struct ch_thread *ntp, struct ch_thread *otp) {
+  cal::KernelProfiler::contextSwitch(ntp, otp);
+}
+
+void calProfilerIrqEnter(void) { cal::KernelProfiler::irqEnter(); }
+
+void calProfilerIrqExit(void) { cal::KernelProfiler::irqExit(); }
+
+void cal::KernelProfiler::start() {
+  chSysLock();
+  windowStart = chSysGetRealtimeCounterX();
+  sliceStart = windowStart;
+  sliceIrqCycles = 0;
+  irqCycles = 0;
+  irqCount = 0;
+  maxIrqCycles = 0;
+  switches = 0;
+  running = true;
+  chSysUnlock();
+}
+
+void cal::KernelProfiler::contextSwitch(thread_t *ntp, thread_t *otp) {
+  (void)ntp;
+
+  if (!running) {
+    return;
+  }
+
+  chargeSlice(otp, chSysGetRealtimeCounterX());
+  switches++;
+}
+
+/**
+ * @note The counter is read before anything else, so the hook's own overhead
+ *       ends up in the ISR's time rather than the interrupted thread's
+ */
+void cal::KernelProfiler::irqEnter() {
+  rtcnt_t now = chSysGetRealtimeCounterX();
+
+  if (running && irqNesting++ == 0) {
+    irqStart = now;
+  }
+}
+
+void cal::KernelProfiler::irqExit() {
+  if (!running || irqNesting == 0 || --irqNesting > 0) {
+    return;
+  }
+
+  uint32_t cycles = chSysGetRealtimeCounterX() - irqStart;
+  irqCycles += cycles;
+  sliceIrqCycles += cycles;
+  irqCount++;
+  if (cycles > maxIrqCycles) {
+    maxIrqCycles = cycles;
+  }
+}
+
+void cal::KernelProfiler::chargeSlice(thread_t *tp, rtcnt_t now) {
+  uint32_t slice = now - sliceStart;
+
+  tp->calProfilerCycles += slice > sliceIrqCycles ? slice - sliceIrqCycles : 0;
+  sliceStart = now;
+  sliceIrqCycles = 0;
+}
+
+/**
+ * @note Thread shares are read (and reset) one thread at a time after the
+ *       window is closed, so a thread running in between is charged a few
+ *       extra cycles in the next window. That's well below the reported
+ *       resolution.
+ */
+void cal::KernelProfiler::report(cal::Uart& uart) {
+  if (!running) {
+    return;
+  }
+
+  // close the window, charging the reporting thread's slice so far
+  chSysLock();
+  rtcnt_t now = chSysGetRealtimeCounterX();
+  uint32_t window = now - windowStart;
+  chargeSlice(chThdGetSelfX(), now);
+  uint32_t windowIrqCycles = irqCycles;
+  uint32_t windowIrqCount = irqCount;
+  uint32_t windowMaxIrqCycles = maxIrqCycles;
+  uint32_t windowSwitches = switches;
+  windowStart = now;
+  irqCycles = 0;
+  irqCount = 0;
+  maxIrqCycles = 0;
+  switches = 0;
+  chSysUnlock();
+
+  if (window == 0) {
+    return;
+  }
+
+  uint32_t windowUs = RTC2US(STM32_HCLK, window);
+  cal::FixedString<cal::Uart::kMaxMsgLen - 1> line;
+  line << "Profiler: window [" << windowUs / 1000 << "] ms, ["
+      << static_cast<uint64_t>(windowSwitches) * 1000000 / windowUs
+      << "] context switches/s.\n";
+  uart.send(line);
+
+  line.clear();
+  line << "Profiler: ISRs " << percent(windowIrqCycles, window) << " over ["
+      << windowIrqCount << "] ISRs, longest ["
+      << RTC2US(STM32_HCLK, windowMaxIrqCycles) << "] us.\n";
+  uart.send(line);
+
+  // registry iteration takes the kernel lock itself, only the read and
+  // reset of each thread's cycles need it
+  size_t reported = 0;
+  for (thread_t *tp = chRegFirstThread(); tp != nullptr;
+      tp = chRegNextThread(tp)) {
+    if (reported++ >= kMaxThreads) {
+      continue;
+    }
+
+    chSysLock();
+    uint32_t cycles = tp->calProfilerCycles;
+    tp->calProfilerCycles = 0;
+    chSysUnlock();
+
+    line.clear();
+    line << "Profiler: thread [" << (tp->name != nullptr ? tp->name : "?")
+        << "] " << percent(cycles, window) << "\n";
+    uart.send(line);
+  }
+}
+
+cal::FixedString<16> cal::KernelProfiler::percent(uint32_t cycles,
+    uint32_t window) {
+  uint32_t permille = static_cast<uint32_t>(
+      static_cast<uint64_t>(cycles) * 1000 / window);
+
+  cal::FixedString<16> share;
+  share << permille / 10 << "." << permille % 10 << "%";
+  return share;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+
+// @TODO finish the chibios-subsys common header that includes all (cal.hpp)
+#include "../../cal.h"
+#include "../../common/FixedString.h"
+#include "../uart/Uart.h"
+#include "KernelProfilerHooks.h"
+#include "ch.h"
+#include "hal.h"
+
+namespace cal {
+
+/**
+ * @brief Cycle-accurate CPU accounting from the ChibiOS kernel hooks
+ *
+ * The context switch hook charges the cycles since the previous switch to the
+ * thread being switched out, minus the time spent in ISRs meanwhile, which
+ * the IRQ prologue/epilogue hooks account for separately. Each report()
+ * covers the window since the previous one: CPU share of every thread (the
+ * idle thread's share is the spare capacity) and of ISRs, the ISR count and
+ * longest ISR, and the context switch rate.
+ *
+ * Like cal::Uart's callbacks, the hooks are static C-style functions, so the
+ * profiler's state is static too and there is a single, global profiler. See
+ * KernelProfilerHooks.h for the chconf.h setup.
+ *
+ * @note Cycles come from the realtime counter (DWT cycle counter), which
+ *       wraps after ~25 s at 168 MHz. report() must be called more often than
+ *       that for the shares to be meaningful.
+ * @note Nested ISRs are accounted as part of the outermost one
+ * @note With CORTEX_ENABLE_WFI_IDLE the cycle counter stops while the core
+ *       sleeps, so windows and shares only cover the time it was awake. Use
+ *       cal::CpuLoad for the overall load in that case.
+ */
+class KernelProfiler {
+ public:
+  // Max number of threads in a report, the rest are left out
+  static constexpr size_t kMaxThreads = 16;
+
+  /**
+   * @brief Begin accounting, the hooks are no-ops before this is called.
+   * @note Call after chSysInit()
+   */
+  static void start();
+
+  /**
+   * @brief Log CPU shares and ISR and context switch statistics of the window
+   *        since the previous report (or start()), then begin a new window
+   */
+  static void report(cal::Uart& uart);
+
+  // hook implementations, see KernelProfilerHooks.h
+  static void contextSwitch(thread_t *ntp, thread_t *otp);
+  static void irqEnter();
+  static void irqExit();
+
+ private:
+  // @brief Charge the running slice of thread tp up to now, minus ISR time
+  //        (called with the kernel locked or from the hooks)
+  static void chargeSlice(thread_t *tp, rtcnt_t now);
+
+  // @return A share of the window formatted as a percentage, e.g. "12.3%"
+  static cal::FixedString<16> percent(uint32_t cycles, uint32_t window);
+
+  static bool running;
+
+  // start of the current report window, and of the current thread's slice
+  static rtcnt_t windowStart;
+  static rtcnt_t sliceStart;
+
+  // ISR cycles since sliceStart, they're not the running thread's
+  static uint32_t sliceIrqCycles;
+
+  // ISR accounting within the current window
+  static uint32_t irqNesting;
+  static rtcnt_t irqStart;
+  static uint32_t irqCycles;
+  static uint32_t irqCount;
+  static uint32_t maxIrqCycles;
+
+  static uint32_t switches;
+};
+
+}
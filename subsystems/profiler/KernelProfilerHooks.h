@@ -0,0 +1,51 @@
+#pragma once
+
+/**
+ * @brief C entry points of cal::KernelProfiler and cal::CpuLoad, called from
+ *        the kernel hooks in chconf.h
+ *
+ * To profile an application, include this header from its chconf.h (outside
+ * of assembly, i.e. within #if !defined(_FROM_ASM_)) and fill the hooks:
+ *
+ *   CH_CFG_THREAD_EXTRA_FIELDS        CAL_KERNEL_PROFILER_THREAD_FIELDS
+ *   CH_CFG_THREAD_INIT_HOOK(tp)       CAL_KERNEL_PROFILER_THREAD_INIT(tp);
+ *   CH_CFG_CONTEXT_SWITCH_HOOK(n, o)  calProfilerContextSwitch(n, o);
+ *   CH_CFG_IRQ_PROLOGUE_HOOK()        calProfilerIrqEnter();
+ *   CH_CFG_IRQ_EPILOGUE_HOOK()        calProfilerIrqExit();
+ *   CH_CFG_IDLE_ENTER_HOOK()          calLoadIdleEnter();
+ *   CH_CFG_IDLE_LEAVE_HOOK()          calLoadIdleLeave();
+ *
+ * @note chconf.h is included before thread_t is defined, hence the struct
+ *       tag in the declarations
+ */
+
+#include <stdint.h>
+
+// CPU cycles the thread used since the last cal::KernelProfiler report
+#define CAL_KERNEL_PROFILER_THREAD_FIELDS                                   \
+  uint32_t calProfilerCycles;
+
+// @brief Zero a new thread's cycle count, its working area may hold anything
+//        (e.g. the CH_DBG_FILL_THREADS pattern)
+#define CAL_KERNEL_PROFILER_THREAD_INIT(tp)                                 \
+  ((tp)->calProfilerCycles = 0)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct ch_thread;
+
+// @note Called with the kernel locked, just before switching threads
+void calProfilerContextSwitch(struct ch_thread *ntp, struct ch_thread *otp);
+
+void calProfilerIrqEnter(void);
+void calProfilerIrqExit(void);
+
+// @note Called with the kernel locked, no OS functions allowed
+void calLoadIdleEnter(void);
+void calLoadIdleLeave(void);
+
+#ifdef __cplusplus
+}
+#endif
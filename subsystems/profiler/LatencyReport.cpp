@@ -0,0 +1,26 @@
+#include "../../cal.h"
+#include "LatencyReport.h"
+
+#include "../uart/Uart.h"
+#include "../../common/FixedString.h"
+#include "../../common/Histogram.h"
+#include "ch.h"
+#include "hal.h"
+
+/**
+ * @note Split over two lines, the UART's messages are limited to kMaxMsgLen
+ */
+void cal::LatencyReport::report(cal::Uart& uart, const char *name,
+    cal::Histogram& latency) {
+  cal::Histogram::Snapshot s = latency.snapshotAndReset();
+
+  cal::FixedString<cal::Uart::kMaxMsgLen - 1> line;
+  line << "Latency: [" << name << "] [" << s.count << "] samples, max ["
+      << s.max << "] us.\n";
+  uart.send(line);
+
+  line.clear();
+  line << "Latency: [" << name << "] p50 [" << s.p50 << "] p90 [" << s.p90
+      << "] p99 [" << s.p99 << "] p99.9 [" << s.p999 << "] us.\n";
+  uart.send(line);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+// @TODO finish the chibios-subsys common header that includes all (cal.hpp)
+#include "../../cal.h"
+#include "../uart/Uart.h"
+#include "../../common/Histogram.h"
+#include "ch.h"
+#include "hal.h"
+
+namespace cal {
+
+/**
+ * @brief UART dump of latency histograms (e.g. the ones recorded by
+ *        EventQueue::setLatencyHistogram() and Uart::setTxLatencyHistogram())
+ */
+class LatencyReport {
+ public:
+  /**
+   * @brief Log the sample count, percentiles and max recorded since the
+   *        previous report, then start a new period
+   * @param name Label of the measured path, keep it short
+   */
+  static void report(cal::Uart& uart, const char *name,
+      cal::Histogram& latency);
+};
+
+}
@@ -0,0 +1,94 @@
+#include "../../cal.h"
+#include "StatsShell.h"
+
+#include <cstring>
+
+#include "../thread/ActiveObject.h"
+#include "../uart/Uart.h"
+#include "../../common/Event.h"
+#include "../../common/EventQueue.h"
+#include "../../common/FixedString.h"
+#include "../../common/Stats.h"
+#include "ch.h"
+#include "hal.h"
+
+// Definitions for static members
+constexpr size_t cal::StatsShell::kMaxLineLen;
+
+cal::StatsShell::StatsShell(const char *name)
+    : cal::ActiveObject<768>(name) {}
+
+void cal::StatsShell::start(cal::Uart& uart, EventQueue *forward) {
+  m_uart = &uart;
+  m_forward = forward;
+  cal::ActiveObject<768>::start();
+}
+
+void cal::StatsShell::handle(Event& e) {
+  if (m_forward != nullptr) {
+    // the downstream queue gets its own payload reference
+    e.retainPayload();
+    m_forward->push(e);
+  }
+
+  if (e.type() != Event::Type::kUartRx) {
+    return;
+  }
+
+  char c = e.getByte();
+  if (c == '\r' || c == '\n') {
+    if (m_lineLen > 0 && !m_lineTooLong) {
+      m_line[m_lineLen] = '\0';
+      execute();
+    }
+    m_lineLen = 0;
+    m_lineTooLong = false;
+  } else if (m_lineLen < kMaxLineLen) {
+    m_line[m_lineLen++] = c;
+  } else {
+    m_lineTooLong = true;
+  }
+}
+
+void cal::StatsShell::execute() {
+  static constexpr char kCommand[] = "stats";
+  static constexpr size_t kCommandLen = sizeof(kCommand) - 1;
+
+  const char *line = m_line.data();
+  if (std::strncmp(line, kCommand, kCommandLen) != 0
+      || (line[kCommandLen] != '\0' && line[kCommandLen] != ' ')) {
+    return;
+  }
+
+  const char *prefix = line + kCommandLen;
+  while (*prefix == ' ') {
+    prefix++;
+  }
+
+  cal::FixedString<cal::Uart::kMaxMsgLen - 1> out;
+  size_t listed = 0;
+  for (size_t i = 0; i < cal::Stats::size(); i++) {
+    const cal::Stats::Stat& stat = cal::Stats::at(i);
+    if (!stat.matches(prefix)) {
+      continue;
+    }
+
+    out.clear();
+    out << "Stats: [" << stat.group << "." << stat.name << "] ["
+        << stat.read() << "]\n";
+    sendLine(out);
+    listed++;
+  }
+
+  out.clear();
+  out << "Stats: [" << listed << "] listed.\n";
+  sendLine(out);
+}
+
+/**
+ * @note Waits on the UART's TX queue, woken as soon as a transmission frees
+ *       up space, instead of polling it
+ */
+void cal::StatsShell::sendLine(cal::StringView line) {
+  m_uart->write(line.data(), line.size());
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <array>
+
+// @TODO finish the chibios-subsys common header that includes all (cal.hpp)
+#include "../../cal.h"
+#include "../thread/ActiveObject.h"
+#include "../uart/Uart.h"
+#include "../../common/Event.h"
+#include "../../common/EventQueue.h"
+#include "../../common/FixedString.h"
+#include "../../common/Stats.h"
+#include "ch.h"
+#include "hal.h"
+
+namespace cal {
+
+/**
+ * @brief Line-based command shell over a cal::Uart for reading cal::Stats
+ *        while the system runs
+ *
+ * Give the shell's queue to the cal::Uart as its RX queue. Commands:
+ *
+ *   stats           list every registered stat and its value
+ *   stats <prefix>  list the stats whose "group.name" starts with prefix,
+ *                   e.g. "stats uart" or "stats fsm.depth"
+ *
+ * Lines that aren't commands are ignored, so the shell can share the RX
+ * stream with binary protocols: every received byte is forwarded, unchanged,
+ * to an optional downstream queue (e.g. an EventSim's scenario input).
+ *
+ * @note Output is paced by the UART's free TX space, so listing many stats
+ *       doesn't drop bytes (or those of other senders)
+ */
+class StatsShell : public cal::ActiveObject<768> {
+ public:
+  // Longest command line, longer lines are ignored
+  static constexpr size_t kMaxLineLen = 32;
+
+  explicit StatsShell(const char *name);
+
+  /**
+   * @brief Begin handling received bytes
+   * @param uart Interface to reply over
+   * @param forward Queue every received byte is forwarded to, if any
+   */
+  void start(cal::Uart& uart, EventQueue *forward = nullptr);
+
+ private:
+  void handle(Event& e) override;
+
+  // @brief Run a complete command line
+  void execute();
+
+  // @brief Send a line, waiting for room in the TX queue
+  void sendLine(cal::StringView line);
+
+  cal::Uart *m_uart = nullptr;
+  EventQueue *m_forward = nullptr;
+
+  std::array<char, kMaxLineLen + 1> m_line = {};
+  size_t m_lineLen = 0;
+  bool m_lineTooLong = false;
+};
+
+}
@@ -0,0 +1,54 @@
+#include "../../cal.h"
+#include "ActiveObject.h"
+
+#include "../../common/Event.h"
+#include "../../common/EventQueue.h"
+#include "ch.h"
+#include "hal.h"
+
+cal::ActiveObjectBase::ActiveObjectBase() {}
+
+void cal::ActiveObjectBase::post(Event e) { m_queue.push(e); }
+
+bool cal::ActiveObjectBase::tryPost(Event e) { return m_queue.tryPush(e); }
+
+EventQueue& cal::ActiveObjectBase::queue() { return m_queue; }
+
+uint32_t cal::ActiveObjectBase::dispatchCount() const {
+  return m_dispatchCount;
+}
+
+rtcnt_t cal::ActiveObjectBase::maxDispatchCycles() const {
+  return m_maxDispatchCycles;
+}
+
+void cal::ActiveObjectBase::dispatchLoop() {
+  while (true) {
+    // sleep until a producer posts, no polling interval to tune
+    m_queue.wait();
+
+    // always deplete the queue before blocking again. Popping until there's
+    // nothing to pop, not by size(), which counts events producers are still
+    // writing: spinning on one would starve a preempted producer.
+    Event e;
+    while (m_queue.tryPop(e)) {
+      if (e.type() == Event::Type::kNone) {
+        // skipped, but the queue's reference must still be dropped
+        e.releasePayload();
+        continue;
+      }
+
+      rtcnt_t start = chSysGetRealtimeCounterX();
+      handle(e);
+      rtcnt_t elapsed = chSysGetRealtimeCounterX() - start;
+
+      // this queue's reference, handlers retain payloads they keep
+      e.releasePayload();
+
+      m_dispatchCount++;
+      if (elapsed > m_maxDispatchCycles) {
+        m_maxDispatchCycles = elapsed;
+      }
+    }
+  }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// @TODO finish the chibios-subsys common header that includes all (cal.hpp)
+#include "../../cal.h"
+#include "../../common/Event.h"
+#include "../../common/EventQueue.h"
+#include "Thread.h"
+#include "ch.h"
+#include "hal.h"
+
+namespace cal {
+
+/**
+ * @brief Size-independent part of cal::ActiveObject
+ *
+ * Other modules only need a reference to this base to post events to an
+ * active object, regardless of its stack size and priority.
+ */
+class ActiveObjectBase {
+ public:
+  // instances own a queue that producers hold references to
+  ActiveObjectBase(const ActiveObjectBase&) = delete;
+  ActiveObjectBase& operator=(const ActiveObjectBase&) = delete;
+
+  // @brief Thread-safe post of an event to this object's queue
+  void post(Event e);
+
+  // @brief Non-blocking post for use from driver callbacks
+  // @return Success in posting as true, false if the queue was full
+  bool tryPost(Event e);
+
+  // @return This object's event queue (e.g. to pass to a subsystem that
+  //         produces events, like cal::Uart)
+  EventQueue& queue();
+
+  // @return Number of events dispatched to handle() so far
+  uint32_t dispatchCount() const;
+
+  // @return Longest time spent in a single handle() call, in realtime
+  //         counter cycles
+  rtcnt_t maxDispatchCycles() const;
+
+ protected:
+  ActiveObjectBase();
+
+  /**
+   * @brief Handle a single event. Runs to completion on the object's own
+   *        thread: no other event is dispatched to this object until it
+   *        returns, so handlers never need to lock the object's state.
+   * @note The event's payload (if any) is released once handle() returns,
+   *       retain it (e.g. with Event::retainPayload()) to keep it or forward
+   *       the event
+   */
+  virtual void handle(Event& e) = 0;
+
+  // @brief Block on the queue and dispatch events forever
+  void dispatchLoop();
+
+ private:
+  // many producers (e.g. cal::Uart, cal::TimerService and other objects'
+  // threads) and one consumer, pushes never mask interrupts or wait on a
+  // lock held by a lower priority producer
+  cal::LockFreeEventQueue m_queue;
+
+  uint32_t m_dispatchCount = 0;
+  rtcnt_t m_maxDispatchCycles = 0;
+};
+
+/**
+ * @brief Event-driven module with its own thread and event queue
+ *
+ * Derived classes implement handle(), then call start() once. The thread
+ * blocks on the queue (no polling) and dispatches each event in FIFO order with
+ * run-to-completion semantics. Modules talk to each other purely by posting
+ * events to one another's ActiveObjectBase references.
+ *
+ * @tparam StackSize Bytes of stack for the dispatch thread
+ * @tparam Priority ChibiOS priority of the dispatch thread
+ *
+ * @note Like cal::Thread, an active object owns its working area and should be
+ *       given static storage duration
+ */
+template <size_t StackSize, tprio_t Priority = NORMALPRIO>
+class ActiveObject : public ActiveObjectBase {
+ public:
+  explicit ActiveObject(const char *name);
+
+  // @brief Start dispatching events posted to this object
+  void start();
+
+  // @return The dispatch thread (e.g. for stack reporting)
+  const cal::Thread<StackSize, Priority>& thread() const;
+
+ private:
+  cal::Thread<StackSize, Priority> m_thread;
+};
+
+}
+
+#include "ActiveObject.inc"
@@ -0,0 +1,96 @@
+#include "../../cal.h"
+#include "TaskScheduler.h"
+
+#include "../../common/Channel.h"
+#include "../../common/Delegate.h"
+#include "../../common/EventQueue.h"
+#include "../../common/Task.h"
+#include "ch.h"
+#include "hal.h"
+
+cal::TaskSchedulerBase::TaskSchedulerBase() {
+  // taken, tasks run on the first pass regardless
+  chBSemObjectInit(&m_wake, true);
+}
+
+/**
+ * @note Tasks are linked at the head, which the dispatch loop only reads at
+ *       the start of a pass, so adding doesn't disturb a pass in progress
+ */
+void cal::TaskSchedulerBase::add(cal::Task& task) {
+  chSysLock();
+  task.m_next = m_tasks;
+  m_tasks = &task;
+  m_taskCount++;
+  chSysUnlock();
+
+  wake();
+}
+
+void cal::TaskSchedulerBase::wake() {
+  syssts_t sts = chSysGetStatusAndLockX();
+  chBSemSignalI(&m_wake);
+  chSysRestoreStatusX(sts);
+}
+
+cal::Delegate<void()> cal::TaskSchedulerBase::waker() {
+  return cal::Delegate<void()>::bind<TaskSchedulerBase,
+      &TaskSchedulerBase::wake>(*this);
+}
+
+void cal::TaskSchedulerBase::watch(EventQueue& queue) {
+  queue.setPushHook(waker());
+}
+
+void cal::TaskSchedulerBase::watch(cal::ChannelBase& channel) {
+  channel.setPushHook(waker());
+}
+
+size_t cal::TaskSchedulerBase::taskCount() const { return m_taskCount; }
+
+uint32_t cal::TaskSchedulerBase::resumeCount() const {
+  return m_resumeCount;
+}
+
+/**
+ * @note The semaphore remembers a wake() during a pass, so a condition that
+ *       changed after its task was resumed gets another pass right away
+ */
+void cal::TaskSchedulerBase::dispatchLoop() {
+  while (true) {
+    chBSemWaitTimeout(&m_wake, resumeAll());
+  }
+}
+
+systime_t cal::TaskSchedulerBase::resumeAll() {
+  chSysLock();
+  Task *head = m_tasks;
+  chSysUnlock();
+
+  systime_t now = chVTGetSystemTimeX();
+  bool sleeping = false;
+  uint32_t earliest = 0;
+
+  for (Task *task = head; task != nullptr; task = task->m_next) {
+    if (task->done()) {
+      continue;
+    }
+    task->resume(now);
+    m_resumeCount++;
+
+    uint32_t when;
+    if (task->deadline(when) && (!sleeping
+        || static_cast<int32_t>(when - earliest) < 0)) {
+      earliest = when;
+      sleeping = true;
+    }
+  }
+
+  if (!sleeping) {
+    return TIME_INFINITE;
+  }
+
+  // time went by during the pass
+  int32_t remaining = static_cast<int32_t>(earliest - chVTGetSystemTimeX());
+  return remaining > 0 ? static_cast<systime_t>(remaining) : TIME_IMMEDIATE;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// @TODO finish the chibios-subsys common header that includes all (cal.hpp)
+#include "../../cal.h"
+#include "../../common/Channel.h"
+#include "../../common/Delegate.h"
+#include "../../common/EventQueue.h"
+#include "../../common/Task.h"
+#include "Thread.h"
+#include "ch.h"
+#include "hal.h"
+
+namespace cal {
+
+/**
+ * @brief Size-independent part of cal::TaskScheduler
+ *
+ * Tasks only need a reference to this base to be added, and event sources only
+ * need its waker().
+ */
+class TaskSchedulerBase {
+ public:
+  // tasks and event sources reference the scheduler by address
+  TaskSchedulerBase(const TaskSchedulerBase&) = delete;
+  TaskSchedulerBase& operator=(const TaskSchedulerBase&) = delete;
+
+  /**
+   * @brief Run a task on this scheduler, from the top of its run() on the
+   *        next pass. Thread-safe.
+   * @note A task may only be added to one scheduler, once
+   */
+  void add(cal::Task& task);
+
+  // @brief Have the scheduler resume its waiting tasks, callable from any
+  //        context (e.g. when something a task awaits may have changed)
+  void wake();
+
+  // @return wake() bound to this scheduler, for event source hooks such as
+  //         cal::Uart::setTxHook()
+  cal::Delegate<void()> waker();
+
+  // @brief Wake the scheduler on every push to queue, for tasks awaiting its
+  //        events. Replaces any other push hook of the queue.
+  void watch(EventQueue& queue);
+
+  // @brief Wake the scheduler on every commit to channel, for tasks awaiting
+  //        its items. Replaces any other push hook of the channel.
+  void watch(cal::ChannelBase& channel);
+
+  // @return Number of tasks added
+  size_t taskCount() const;
+
+  // @return Number of Task::resume() calls so far
+  uint32_t resumeCount() const;
+
+ protected:
+  TaskSchedulerBase();
+
+  // @brief Resume every task whenever woken or a sleeping task is due,
+  //        forever
+  void dispatchLoop();
+
+ private:
+  /**
+   * @brief Resume every unfinished task once
+   * @return Ticks until the earliest sleeping task is due, TIME_INFINITE if
+   *         none sleep
+   */
+  systime_t resumeAll();
+
+  Task *m_tasks = nullptr;
+  size_t m_taskCount = 0;
+  uint32_t m_resumeCount = 0;
+
+  // signaled by wake(), taken by the dispatch loop
+  binary_semaphore_t m_wake;
+};
+
+/**
+ * @brief Runs any number of cal::Task coroutines on a single thread
+ *
+ * The thread sleeps until woken (wake(), a watched queue's push, a hook) or
+ * until the earliest CAL_TASK_SLEEP() deadline, then resumes every task once.
+ * Each task re-checks its await condition and either continues or returns
+ * right away, so a pass costs a few cycles per waiting task; that suits tens
+ * of small tasks, not hundreds.
+ *
+ * @tparam StackSize Bytes of stack for the thread, shared by all tasks (they
+ *         only use it between two awaits)
+ * @tparam Priority ChibiOS priority of the thread
+ *
+ * @note Like cal::Thread, a scheduler owns its working area and should be
+ *       given static storage duration
+ * @note Tasks are cooperative, one that doesn't await stalls all the others
+ */
+template <size_t StackSize, tprio_t Priority = NORMALPRIO>
+class TaskScheduler : public TaskSchedulerBase {
+ public:
+  explicit TaskScheduler(const char *name);
+
+  // @brief Start resuming the added tasks
+  void start();
+
+  // @return The scheduler's thread (e.g. for stack reporting)
+  const cal::Thread<StackSize, Priority>& thread() const;
+
+ private:
+  cal::Thread<StackSize, Priority> m_thread;
+};
+
+}
+
+#include "TaskScheduler.inc"
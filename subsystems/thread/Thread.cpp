@@ -0,0 +1,83 @@
+#include "../../cal.h"
+#include "Thread.h"
+
+#include "../uart/Uart.h"
+#include "ch.h"
+#include "hal.h"
+
+// Definitions for static members
+std::atomic<cal::ThreadBase *> cal::ThreadBase::registry{nullptr};
+
+cal::ThreadBase::ThreadBase(const char *name, stkalign_t *workingArea,
+    size_t workingAreaSize) : m_name(name), m_workingArea(workingArea),
+  m_workingAreaSize(workingAreaSize) {
+  // register with all other threads for reporting. Not under the kernel lock,
+  // static instances are constructed before chSysInit(), and function-local
+  // ones may be constructed by concurrent threads later.
+  m_next = cal::ThreadBase::registry.load(std::memory_order_relaxed);
+  while (!cal::ThreadBase::registry.compare_exchange_weak(m_next, this,
+      std::memory_order_release, std::memory_order_relaxed)) {
+  }
+}
+
+const char *cal::ThreadBase::name() const { return m_name; }
+
+size_t cal::ThreadBase::stackSize() const {
+  return m_workingAreaSize - sizeof(thread_t);
+}
+
+/**
+ * @note The stack grows down towards the start of the working area, so the
+ *       bytes still holding the fill pattern at the bottom were never touched
+ */
+size_t cal::ThreadBase::stackHighWater() const {
+#if CH_DBG_FILL_THREADS == TRUE
+  if (m_thread == nullptr) {
+    return 0;
+  }
+
+  const uint8_t *bottom = reinterpret_cast<const uint8_t *>(m_workingArea);
+  size_t unused = 0;
+  while (unused < stackSize() && bottom[unused] == CH_DBG_STACK_FILL_VALUE) {
+    unused++;
+  }
+
+  return stackSize() - unused;
+#else
+  return stackSize();
+#endif
+}
+
+bool cal::ThreadBase::isStarted() const { return m_thread != nullptr; }
+
+thread_t *cal::ThreadBase::handle() const { return m_thread; }
+
+void cal::ThreadBase::reportStacks(cal::Uart& uart) {
+  for (cal::ThreadBase *t =
+      cal::ThreadBase::registry.load(std::memory_order_acquire); t != nullptr;
+      t = t->m_next) {
+    uart.send("Thread [");
+    uart.send(t->name());
+    uart.send("] stack: ");
+    uart.send(static_cast<int>(t->stackHighWater()));
+    uart.send("/");
+    uart.send(static_cast<int>(t->stackSize()));
+    uart.send(t->isStarted() ? " bytes\n" : " bytes (not started)\n");
+  }
+}
+
+void cal::ThreadBase::create(tprio_t priority, EntryFunc entry, void *arg) {
+  chDbgAssert(m_thread == nullptr, "thread already started");
+
+  m_entry = entry;
+  m_arg = arg;
+  m_thread = chThdCreateStatic(m_workingArea, m_workingAreaSize, priority,
+      &cal::ThreadBase::run, this);
+}
+
+void cal::ThreadBase::run(void *arg) {
+  cal::ThreadBase *_this = static_cast<cal::ThreadBase *>(arg);
+
+  chRegSetThreadName(_this->m_name);
+  _this->m_entry(_this->m_arg);
+}
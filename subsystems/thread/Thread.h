@@ -0,0 +1,137 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <atomic>
+
+// @TODO finish the chibios-subsys common header that includes all (cal.hpp)
+#include "../../cal.h"
+#include "../uart/Uart.h"
+#include "ch.h"
+#include "hal.h"
+
+namespace cal {
+
+/**
+ * @brief Size-independent part of cal::Thread
+ *
+ * Every thread registers itself in a static, intrusive list at construction so
+ * that stack usage of all cal::Threads can be reported at runtime without
+ * knowing their template parameters.
+ *
+ * @note Stack high-water marks rely on ChibiOS filling working areas with
+ *       CH_DBG_STACK_FILL_VALUE at thread creation, which requires
+ *       CH_DBG_FILL_THREADS to be TRUE in chconf.h. Without it, the whole stack
+ *       is reported as used.
+ */
+class ThreadBase {
+ public:
+  // Thread entry point, same signature as a ChibiOS THD_FUNCTION
+  using EntryFunc = void (*)(void *arg);
+
+  // instances are registered by address, and own their working area
+  ThreadBase(const ThreadBase&) = delete;
+  ThreadBase& operator=(const ThreadBase&) = delete;
+
+  // @return Name the thread was constructed with
+  const char *name() const;
+
+  // @return Bytes of stack available to the thread (the working area minus
+  //         the thread descriptor ChibiOS places at its top)
+  size_t stackSize() const;
+
+  // @return Most bytes of stack the thread has used since it was started
+  size_t stackHighWater() const;
+
+  // @return True once start() has created the thread
+  bool isStarted() const;
+
+  // @return ChibiOS thread handle (nullptr until started)
+  thread_t *handle() const;
+
+  /**
+   * @brief Log name, stack high-water mark and stack size of every
+   *        constructed cal::Thread, one thread per line
+   */
+  static void reportStacks(cal::Uart& uart);
+
+ protected:
+  ThreadBase(const char *name, stkalign_t *workingArea,
+      size_t workingAreaSize);
+
+  // @brief Create the ChibiOS thread on the working area and run entry(arg)
+  void create(tprio_t priority, EntryFunc entry, void *arg);
+
+ private:
+  // @brief Common thread function, names the thread then runs the entry
+  static void run(void *arg);
+
+  const char *m_name;
+  stkalign_t *m_workingArea;
+  size_t m_workingAreaSize;
+
+  EntryFunc m_entry = nullptr;
+  void *m_arg = nullptr;
+  thread_t *m_thread = nullptr;
+
+  // registry of all constructed threads, pushed to with a compare-and-swap
+  // since static instances are constructed before the kernel is initialized
+  ThreadBase *m_next = nullptr;
+  static std::atomic<ThreadBase *> registry;
+};
+
+/**
+ * @brief Thread running on a statically allocated working area
+ *
+ * Replaces the THD_WORKING_AREA/chThdCreateStatic pair. The working area is a
+ * member, so a cal::Thread should be given static storage duration (global or
+ * function-local static) like the THD_WORKING_AREA it replaces.
+ *
+ * @tparam StackSize Bytes of stack for the thread function (excluding the
+ *         thread descriptor), checked at compile time
+ * @tparam Priority ChibiOS priority the thread is created with
+ *
+ * @note Use ThreadBase::reportStacks() after exercising the application to
+ *       find the actual stack usage, then shrink StackSize accordingly
+ */
+template <size_t StackSize, tprio_t Priority = NORMALPRIO>
+class Thread : public ThreadBase {
+ public:
+  // Smallest stack that fits the port's interrupt/context switch frames with
+  // some room for the thread function itself
+  static constexpr size_t kMinStackSize = 128;
+
+  static_assert(StackSize >= kMinStackSize,
+      "cal::Thread stack is too small to hold the port's context frames");
+  static_assert(StackSize % sizeof(stkalign_t) == 0,
+      "cal::Thread stack size must be a multiple of the stack alignment");
+  static_assert(Priority > IDLEPRIO && Priority <= HIGHPRIO,
+      "cal::Thread priority must be between IDLEPRIO and HIGHPRIO");
+
+  explicit Thread(const char *name);
+
+  // @brief Run a THD_FUNCTION style function
+  void start(EntryFunc entry, void *arg);
+
+  // @brief Run a member function of obj
+  template <class T, void (T::*Func)()>
+  void start(T *obj);
+
+  // @brief Run a callable (e.g. lambda), which must outlive the thread
+  template <class F>
+  void start(F& func);
+
+ private:
+  template <class T, void (T::*Func)()>
+  static void invokeMember(void *obj);
+
+  template <class F>
+  static void invokeCallable(void *func);
+
+  THD_WORKING_AREA(m_workingArea, StackSize);
+};
+
+}
+
+#include "Thread.inc"
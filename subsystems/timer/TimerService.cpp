@@ -0,0 +1,142 @@
+#include "../../cal.h"
+#include "TimerService.h"
+
+// @TODO fix include dirs w/ local Makefile
+#include "../../common/Event.h"
+#include "../../common/EventQueue.h"
+#include "../../common/Stats.h"
+#include "../../common/TimerWheel.h"
+#include "ch.h"
+#include "hal.h"
+
+// Definitions for static members
+constexpr cal::TimerServiceBase::TimerId cal::TimerServiceBase::kInvalidTimer;
+
+cal::TimerServiceBase::TimerServiceBase() { chVTObjectInit(&m_timer); }
+
+void cal::TimerServiceBase::init(cal::TimerWheelBase& wheel,
+    EventQueue **owners) {
+  m_wheel = &wheel;
+  m_owners = owners;
+
+  // the wheel starts at tick 0, catch it up with the system time
+  chSysLock();
+  m_wheel->advance(chVTGetSystemTimeX());
+  chSysUnlock();
+}
+
+cal::TimerServiceBase::TimerId cal::TimerServiceBase::startOneShot(EventQueue& owner,
+    systime_t delay) {
+  return start(owner, delay, 0);
+}
+
+cal::TimerServiceBase::TimerId cal::TimerServiceBase::startPeriodic(
+    EventQueue& owner, systime_t period) {
+  return start(owner, period, period);
+}
+
+cal::TimerServiceBase::TimerId cal::TimerServiceBase::start(EventQueue& owner,
+    systime_t delay, systime_t period) {
+  chSysLock();
+  // expiries are relative to the wheel's time, so bring it up to date first
+  m_wheel->advance(chVTGetSystemTimeX());
+  TimerId id = m_wheel->start(m_wheel->now() + delay, period);
+  if (id != kInvalidTimer) {
+    m_owners[cal::TimerWheelBase::index(id)] = &owner;
+  }
+  rearmI();
+  chSysUnlock();
+
+  // catching up may have expired other timers, and a 0 delay expires at once
+  postExpired();
+
+  return id;
+}
+
+bool cal::TimerServiceBase::cancel(TimerId id) {
+  chSysLock();
+  bool wasRunning = m_wheel->cancel(id);
+  rearmI();
+  chSysUnlock();
+
+  return wasRunning;
+}
+
+size_t cal::TimerServiceBase::active() {
+  chSysLock();
+  size_t count = m_wheel->active();
+  chSysUnlock();
+
+  return count;
+}
+
+uint32_t cal::TimerServiceBase::droppedEvents() const {
+  return m_droppedEvents.value();
+}
+
+void cal::TimerServiceBase::registerStats(const char *group) {
+  cal::Stats::add(group, "active", [] (void *arg) -> uint32_t {
+    return static_cast<cal::TimerServiceBase *>(arg)->active();
+  }, this);
+  cal::Stats::add(group, "dropped", m_droppedEvents);
+}
+
+/**
+ * @note The kernel is only locked to pop one timer at a time, pushing to the
+ *       owner's queue happens outside of the lock
+ */
+void cal::TimerServiceBase::postExpired() {
+  while (true) {
+    uint16_t overruns = 0;
+
+    syssts_t sts = chSysGetStatusAndLockX();
+    TimerId id = m_wheel->popExpired(overruns);
+    EventQueue *owner = id != kInvalidTimer
+      ? m_owners[cal::TimerWheelBase::index(id)] : nullptr;
+    chSysRestoreStatusX(sts);
+
+    if (owner == nullptr) {
+      return;
+    }
+
+    if (!owner->tryPush(Event(Event::Type::kTimerTimeout, id, overruns))) {
+      m_droppedEvents.increment();
+    }
+  }
+}
+
+/**
+ * @note A next event that's already due (e.g. the wheel fell behind) is
+ *       handled on the next tick, chVTSetI() clamps the delay to the
+ *       tickless minimum (CH_CFG_ST_TIMEDELTA)
+ */
+void cal::TimerServiceBase::rearmI() {
+  uint32_t next;
+  if (!m_wheel->nextEvent(next)) {
+    chVTResetI(&m_timer);
+    return;
+  }
+
+  systime_t delay = next - chVTGetSystemTimeX();
+  // already due (or passed, which shows up as a wrapped, huge delay)
+  if (delay == 0 || delay > next - m_wheel->now()) {
+    delay = 1;
+  }
+
+  chVTSetI(&m_timer, delay, &cal::TimerServiceBase::timerCallback, this);
+}
+
+void cal::TimerServiceBase::timerCallback(void *arg) {
+  cal::TimerServiceBase *_this = static_cast<cal::TimerServiceBase *>(arg);
+
+  chSysLockFromISR();
+  _this->m_wheel->advance(chVTGetSystemTimeX());
+  chSysUnlockFromISR();
+
+  // periodic timers are re-inserted as they're popped, so re-arm after
+  _this->postExpired();
+
+  chSysLockFromISR();
+  _this->rearmI();
+  chSysUnlockFromISR();
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <array>
+
+// @TODO finish the chibios-subsys common header that includes all (cal.hpp)
+#include "../../cal.h"
+#include "../../common/Event.h"
+#include "../../common/EventQueue.h"
+#include "../../common/Stats.h"
+#include "../../common/TimerWheel.h"
+#include "ch.h"
+#include "hal.h"
+
+namespace cal {
+
+/**
+ * @brief Software timers posting kTimerTimeout events to their owners' queues
+ *
+ * Replaces threads that loop on chThdSleepMilliseconds() (and the stack each
+ * one burns) with one-shot and periodic timers in a cal::TimerWheel. A single
+ * ChibiOS virtual timer is kept armed at the wheel's next event, so with the
+ * tickless kernel the CPU is only woken when a timer actually expires (or a
+ * wheel slot cascades).
+ *
+ * Expiries are posted as Event(Event::Type::kTimerTimeout, id, overruns),
+ * where overruns counts periods of a periodic timer that expired while its
+ * event couldn't be posted on time.
+ *
+ * @note Like driver callbacks, expiries are posted from the virtual timer
+ *       callback with tryPush(), events that can't be pushed are dropped and
+ *       counted by droppedEvents()
+ * @note All times are in system ticks (CH_CFG_ST_FREQUENCY)
+ * @note Instantiated as a cal::TimerService, which holds the timers
+ */
+class TimerServiceBase {
+ public:
+  using TimerId = cal::TimerWheelBase::TimerId;
+
+  static constexpr TimerId kInvalidTimer = cal::TimerWheelBase::kInvalidTimer;
+
+  // instances are referenced by address from the virtual timer
+  TimerServiceBase(const TimerServiceBase&) = delete;
+  TimerServiceBase& operator=(const TimerServiceBase&) = delete;
+
+  /**
+   * @brief Post a single kTimerTimeout event to owner after delay
+   * @return The timer's ID, kInvalidTimer if every timer is running
+   */
+  TimerId startOneShot(EventQueue& owner, systime_t delay);
+
+  /**
+   * @brief Post a kTimerTimeout event to owner every period, the first one
+   *        period from now
+   * @return The timer's ID, kInvalidTimer if every timer is running
+   */
+  TimerId startPeriodic(EventQueue& owner, systime_t period);
+
+  /**
+   * @brief Stop a timer, its pending expiry (if any) isn't posted
+   * @return False if the timer wasn't running
+   */
+  bool cancel(TimerId id);
+
+  // @return Number of running timers
+  size_t active();
+
+  // @return Number of expiry events that couldn't be pushed
+  uint32_t droppedEvents() const;
+
+  // @brief Register running timers and dropped events in cal::Stats
+  void registerStats(const char *group);
+
+ protected:
+  TimerServiceBase();
+
+  // @brief Take over the wheel and the owner of each of its nodes, catching
+  //        the wheel up with the system time
+  void init(cal::TimerWheelBase& wheel, EventQueue **owners);
+
+ private:
+  TimerId start(EventQueue& owner, systime_t delay, systime_t period);
+
+  // @brief Post the events of every expired timer, callable from any context
+  void postExpired();
+
+  // @brief Arm the virtual timer for the wheel's next event
+  //        (called with the kernel locked)
+  void rearmI();
+
+  // @brief Advances the wheel and posts expiries, fires at the next event
+  static void timerCallback(void *arg);
+
+  cal::TimerWheelBase *m_wheel = nullptr;
+
+  // owner queue of each timer, by node index
+  EventQueue **m_owners = nullptr;
+
+  virtual_timer_t m_timer;
+  cal::Counter m_droppedEvents;
+};
+
+/**
+ * @brief TimerService running up to MaxTimers timers at once
+ *
+ * @code
+ *   static cal::TimerService<16> timers;
+ *   timers.startPeriodic(fsm.queue(), MS2ST(500));
+ * @endcode
+ *
+ * @tparam MaxTimers Max number of running timers, sized like the
+ *         cal::TimerWheel it holds (a node and an owner pointer per timer)
+ */
+template <size_t MaxTimers>
+class TimerService : public TimerServiceBase {
+ public:
+  static constexpr size_t kMaxTimers = MaxTimers;
+
+  TimerService();
+
+ private:
+  cal::TimerWheel<MaxTimers> m_storage;
+  std::array<EventQueue *, MaxTimers> m_ownerStorage = {};
+};
+
+}
+
+#include "TimerService.inc"
@@ -2,13 +2,22 @@
 #include "Uart.h"
 
 #include <mutex>
+#include <cstdarg>
 #include <cstring>
 
 // @TODO fix include dirs w/ local Makefile
 #include "../../common/Gpio.h"
 #include "../../common/Event.h"
 #include "../../common/EventQueue.h"
+#include "../../common/Clock.h"
+#include "../../common/Delegate.h"
+#include "../../common/DriverCallback.h"
+#include "../../common/FixedString.h"
+#include "../../common/Histogram.h"
+#include "../../common/Printf.h"
+#include "../../common/Stats.h"
 #include "ch.h"
+#include "chprintf.h"
 #include "hal.h"
 // @TODO Define pinconfs for every supported board type so that user code
 //       indicates board and then chibios-subsys knows what pin confs to use
@@ -16,8 +25,8 @@
 #include "pinconf.h"
 
 // Definitions for static members
-std::array<UARTDriver *,4> cal::Uart::registeredDrivers = {};
-std::array<cal::Uart *,4> cal::Uart::driverToSubsysLookup = {};
+constexpr size_t cal::Uart::kMaxTrackedSends;
+constexpr size_t cal::Uart::kTxRingSize;
 
 /**
  * TODO: Add private pin mappings for each interface and notes about
@@ -33,11 +42,13 @@ cal::Uart::Uart(UartInterface ui, EventQueue& eq) : m_uartInterface(ui),
   m_eventQueue(eq) {
   // set default config
   // TODO: Initialize interface pins
-  m_uartConfig = {
-    &cal::Uart::txEmpty,   //txend1,// callback: transmission buffer completely read
+  m_uartConfig.config = {
+    &cal::DriverCallback<decltype(&cal::Uart::txEmpty),
+        &cal::Uart::txEmpty>::callback,   //txend1,// callback: transmission buffer completely read
                      // by the driver
     NULL,   //txend2,// callback: a transmission has physically completed
-    &cal::Uart::rxDone, // callback: a receive buffer has been
+    &cal::DriverCallback<decltype(&cal::Uart::rxDone),
+        &cal::Uart::rxDone>::callback, // callback: a receive buffer has been
                                   //completelywritten
     NULL,   //rxchar,// callback: a character is received but the
                      //           application was not ready to receive
@@ -51,13 +62,11 @@ cal::Uart::Uart(UartInterface ui, EventQueue& eq) : m_uartInterface(ui),
 
   // set default driver (TODO: make it based on ui)
   m_uartp = &UARTD3;
-  // register driver statically on class for lookup in static callbacks
-  cal::Uart::registeredDrivers[0] = m_uartp;
-    //Uart::registeredDrivers.size()] = m_uartp;
-  cal::Uart::driverToSubsysLookup[0] = this;
-      //Uart::driverToSubsysLookup.size()] = this;
-  // start interface with default config
-  uartStart(m_uartp, &m_uartConfig);
+
+  chThdQueueObjectInit(&m_txWaiters);
+  // start interface with default config, the callbacks find this instance
+  // through it
+  uartStart(m_uartp, &m_uartConfig.config);
 
   // start the receive
   // @TODO move this to constructor in non-singleton design
@@ -68,9 +77,10 @@ cal::Uart::Uart(UartInterface ui, EventQueue& eq) : m_uartInterface(ui),
 /**
  * @brief Convert a float to a string
  */
-std::string cal::Uart::to_string(float num) {
-  int num_int = static_cast<int>(num);
-  return std::to_string(num_int) + std::string(".X");
+cal::FixedString<16> cal::Uart::to_string(float num) {
+  cal::FixedString<16> str;
+  str << static_cast<int>(num) << ".X";
+  return str;
 }
 
 /*
@@ -85,143 +95,346 @@ void cal::Uart::send(float num) {
 }
 
 void cal::Uart::send(int num) {
-  send(std::to_string(num));
+  // the longest int, "-2147483648"
+  cal::FixedString<11> str;
+  str << num;
+  send(str);
 }
 
-
-/*
- * @brief wrapper for send(char*,uint16) that takes a std::string
- */
-void cal::Uart::send(std::string str) {
-  if (str.length() < kMaxMsgLen) {
-    send(str.c_str(), str.length());
+void cal::Uart::send(cal::StringView str) {
+  if (str.size() < kMaxMsgLen) {
+    send(str.data(), str.size());
   } else {
-    std::string errorMsg = "*UART SubSystem Error: Message exceeds 100"
-                           " character limit*\n";
-    send(errorMsg.c_str(), errorMsg.length());
+    send("\n*UART SubSystem Error: Message exceeds 100 character limit*\n");
   }
 }
 
+void cal::Uart::send(const std::string& str) {
+  send(cal::StringView(str.data(), str.length()));
+}
+
 /*
  * @brief wrapper for send(char*,uint16) that takes a c-style null-terminated
  *        character string
  */
 void cal::Uart::send(char * str) {
-  send(static_cast<const char*>(str), strlen(str));
+  send(cal::StringView(str));
 }
 
 void cal::Uart::send(const char * str) {
-  if (strlen(str) < kMaxMsgLen) {
-    send(str, strlen(str));
-  } else {
-    send("\n*UART SubSystem Error: Message exceeds 100 character limit*\n");
-  }
+  send(cal::StringView(str));
 }
 
 /**
  * @TODO optimize with DMA and/or more efficient copies or moves
  */
 void cal::Uart::send(const char * str, uint16_t len) {
-  // start data transmit if interface is ready
-  if (m_d3IsReady) {
-    m_d3IsReady = false;
-    // copy string contents to class memory
-    std::memcpy(m_txBuffer, str, len);
-    // start transmit from the copied memory
-    uartStopSend(m_uartp);
-    uartStartSend(m_uartp, len, m_txBuffer);
-  } else {
-    // @TODO Consider performance of and alternatives to pushing back every byte
-    //       of the passed string one at a time
-    // @TODO Consider what happens if/when the CircularBuffer tx queue runs out
-    //       of space
-
-    // otherwise, queue for later
-    std::lock_guard<chibios_rt::Mutex> txQueueGuard(m_d3TxQueueMut);
-    // push every byte of the string onto the queue
-    for (uint32_t i = 0; i < len; i++) {
-      // push byte
-      m_d3TxQueue.PushBack(*(str + i));
+  sendAsync(str, len);
+}
+
+/**
+ * @note The copy is made with the kernel locked, so sends from any context are
+ *       serialized. That's well under a microsecond for a kMaxMsgLen message.
+ */
+uint32_t cal::Uart::sendAsync(const char * str, uint16_t len) {
+  uint32_t start = m_txLatency != nullptr ? cal::Clock::now32() : 0;
+
+  if (m_txFullPolicy == cal::TxFullPolicy::kWait) {
+    waitForTxSpace(len);
+  }
+
+  // tracked in the same critical section, before the transmit can complete
+  syssts_t sts = chSysGetStatusAndLockX();
+  size_t queued = queueTxI(str, len);
+  uint32_t ticket = trackSendI(queued, start);
+  chSysRestoreStatusX(sts);
+
+  m_txBytes.increment(queued);
+  if (queued < len) {
+    m_txDroppedBytes.increment(len - queued);
+  }
+  return ticket;
+}
+
+/**
+ * @note The chunks count towards TX latency as one send, tracked with the
+ *       last one
+ */
+size_t cal::Uart::write(const char *str, size_t len, systime_t timeout) {
+  uint32_t start = m_txLatency != nullptr ? cal::Clock::now32() : 0;
+
+  size_t written = 0;
+  chSysLock();
+  while (written < len) {
+    size_t count = txFreeI();
+    if (count == 0) {
+      if (!waitForTxEndS(timeout)) {
+        break;
+      }
+      continue;
     }
+    if (count > len - written) {
+      count = len - written;
+    }
+    if (count > kMaxMsgLen) {
+      count = kMaxMsgLen;
+    }
+    copyTxI(str + written, count);
+    written += count;
+    if (written == len) {
+      trackSendI(len, start);
+    }
+
+    // let interrupts (e.g. the driver's) in between chunks
+    chSysUnlock();
+    chSysLock();
+  }
+  chSysUnlock();
+
+  m_txBytes.increment(written);
+  if (written < len) {
+    m_txDroppedBytes.increment(len - written);
+  }
+  return written;
+}
+
+bool cal::Uart::flush(systime_t timeout) {
+  chSysLock();
+  bool flushed = true;
+  while (m_txBusy && flushed) {
+    flushed = waitForTxEndS(timeout);
+  }
+  chSysUnlock();
+  return flushed;
+}
+
+int cal::Uart::printf(const char *fmt, ...) {
+  char buffer[cal::kMaxPrintfLen + 1];
+
+  va_list ap;
+  va_start(ap, fmt);
+  int size = chvsnprintf(buffer, sizeof(buffer), fmt, ap);
+  va_end(ap);
+
+  if (size > 0) {
+    size_t len = static_cast<size_t>(size);
+    sendAsync(buffer, len < cal::kMaxPrintfLen ? len : cal::kMaxPrintfLen);
   }
+  return size;
+}
+
+void cal::Uart::routePrintf() {
+  cal::setPrintfSink(cal::Delegate<void(const char *, size_t)>::bind<Uart,
+      &Uart::sendPrintf>(*this));
+}
+
+void cal::Uart::sendPrintf(const char *str, size_t len) {
+  sendAsync(str, len);
 }
 
-cal::Uart * cal::Uart::getDriversSubsys(UARTDriver *uartp) {
-  cal::Uart *uartChSubsys = nullptr;
+void cal::Uart::setTxFullPolicy(cal::TxFullPolicy policy, systime_t timeout) {
+  chSysLock();
+  m_txFullPolicy = policy;
+  m_txWaitTimeout = timeout;
+  chSysUnlock();
+}
 
-  for (uint32_t i = 0; i < cal::Uart::registeredDrivers.size(); i++) {
-    UARTDriver *_uartp = cal::Uart::registeredDrivers[i];
-    if (_uartp == uartp) {
-      // found driver's subsys instance
-      uartChSubsys = cal::Uart::driverToSubsysLookup[i];
+/**
+ * @note Another sender may take the space between this returning and the
+ *       send locking the ring, the send then drops
+ */
+void cal::Uart::waitForTxSpace(uint16_t len) {
+  chSysLock();
+  systime_t start = chVTGetSystemTimeX();
+  while (txFreeI() < len && len <= kTxRingSize) {
+    systime_t timeout = m_txWaitTimeout;
+    if (timeout != TIME_INFINITE) {
+      systime_t elapsed = chVTTimeElapsedSinceX(start);
+      if (elapsed >= m_txWaitTimeout) {
+        break;
+      }
+      timeout = m_txWaitTimeout - elapsed;
+    }
+    if (!waitForTxEndS(timeout)) {
+      break;
     }
   }
+  chSysUnlock();
+}
 
-  return uartChSubsys;
+bool cal::Uart::waitForTxEndS(systime_t timeout) {
+  return chThdEnqueueTimeoutS(&m_txWaiters, timeout) == MSG_OK;
 }
 
-void cal::Uart::rxDone(UARTDriver *uartp) {
-  // find class pointer corresponding to this uart driver via static
-  // lookup table
-  cal::Uart *_this = cal::Uart::getDriversSubsys(uartp);
-
-  if (_this != nullptr) {
-    // push byte-read event to the subsystem's event consumer
-    // @TODO Add support for multi-byte messages (complicated given the
-    //       limits on chibios 32b mailboxes, probably need to abstract
-    //       that with the threading). Actually, could pretty easily make
-    //       Events use a pointer to the multiple-byte message
-    Event e = Event(Event::Type::kUartRx, _this->m_rxBuffer[0]);
-    // if the event queue cannot be immediately acquired, the push fails
-    bool success = _this->m_eventQueue.tryPush(e);
-    if (!success) {
-
-      // @TODO implement a callback / condition var notified function
-      // that pushes the event to the queue when it frees up but
-      // doesn't block in this thread when the lock on the consumer's
-      // queue can't immediately be acquired
-
-      // @note currently we drop RX bytes on the floor when the consumer
-      //       isn't ready to receive them (this LED toggles)
-      palTogglePad(STARTUP_LED_PORT, STARTUP_LED_PIN);
+size_t cal::Uart::queueTxI(const char *str, uint16_t len) {
+  size_t space = txFreeI();
+  size_t count = len;
+  if (count > space) {
+    count = m_txFullPolicy == cal::TxFullPolicy::kTruncate ? space : 0;
+  }
+  if (count > 0) {
+    copyTxI(str, count);
+  }
+  return count;
+}
+
+void cal::Uart::copyTxI(const char *str, size_t count) {
+  // the free space may wrap around the end of the ring
+  size_t offset = m_txHead & (kTxRingSize - 1);
+  size_t first = count < kTxRingSize - offset ? count : kTxRingSize - offset;
+  std::memcpy(m_txRing + offset, str, first);
+  std::memcpy(m_txRing, str + first, count - first);
+  m_txHead += count;
+
+  if (!m_txBusy) {
+    startTxI();
+  }
+}
+
+/**
+ * @note The driver transmits straight from the ring, the bytes stay put until
+ *       txEmpty() retires them
+ */
+void cal::Uart::startTxI() {
+  size_t offset = m_txTail & (kTxRingSize - 1);
+  size_t pending = m_txHead - m_txTail;
+  size_t count = pending < kTxRingSize - offset ? pending
+                                                : kTxRingSize - offset;
+  m_txInFlight = count;
+  m_txBusy = true;
+  uartStartSendI(m_uartp, count, m_txRing + offset);
+}
+
+size_t cal::Uart::txFreeI() const {
+  return kTxRingSize - (m_txHead - m_txTail);
+}
+
+/**
+ * @note Tickets are ring positions, a send is done once the ring's tail
+ *       (what the driver has read) passes its last queued byte
+ */
+bool cal::Uart::txDone(uint32_t ticket) {
+  chSysLock();
+  uint32_t finished = m_txTail;
+  chSysUnlock();
+  return static_cast<int32_t>(finished - ticket) >= 0;
+}
+
+void cal::Uart::setTxHook(cal::Delegate<void()> hook) {
+  chSysLock();
+  m_txHook = hook;
+  chSysUnlock();
+}
+
+size_t cal::Uart::txFree() {
+  syssts_t sts = chSysGetStatusAndLockX();
+  size_t space = txFreeI();
+  chSysRestoreStatusX(sts);
+  return space;
+}
+
+void cal::Uart::setTxLatencyHistogram(cal::Histogram *latency) {
+  chSysLock();
+  m_txLatency = latency;
+  m_trackedCount = 0;
+  chSysUnlock();
+}
+
+/**
+ * @note A dropped send's ticket is the tail, it's complete right away. A
+ *       truncated one completes with the bytes that were queued.
+ */
+uint32_t cal::Uart::trackSendI(size_t queued, uint32_t start) {
+  if (queued == 0) {
+    return m_txTail;
+  }
+
+  uint32_t end = m_txHead;
+  if (m_txLatency != nullptr) {
+    if (m_trackedCount == kMaxTrackedSends) {
+      m_trackedHead = (m_trackedHead + 1) % kMaxTrackedSends;
+      m_trackedCount--;
     }
-    // start next rx
-    uartStopReceive(uartp);
-    uartStartReceive(uartp, 1, _this->m_rxBuffer);
-  } else {
-    // ERROR
-    // ...
+    m_trackedSends[(m_trackedHead + m_trackedCount) % kMaxTrackedSends] =
+        {end, start};
+    m_trackedCount++;
+  }
+  return end;
+}
+
+/**
+ * @note Ring positions are compared with signed differences, so they may
+ *       wrap
+ */
+void cal::Uart::completeSendsI() {
+  uint32_t finished = m_txTail;
+  while (m_trackedCount > 0 && static_cast<int32_t>(finished
+      - m_trackedSends[m_trackedHead].end) >= 0) {
+    if (m_txLatency != nullptr) {
+      m_txLatency->record(
+          cal::Clock::elapsedUs(m_trackedSends[m_trackedHead].start));
+    }
+    m_trackedHead = (m_trackedHead + 1) % kMaxTrackedSends;
+    m_trackedCount--;
+  }
+}
+
+void cal::Uart::registerStats(const char *group) {
+  cal::Stats::add(group, "txBytes", m_txBytes);
+  cal::Stats::add(group, "txDropped", m_txDroppedBytes);
+  cal::Stats::add(group, "rxBytes", m_rxBytes);
+  cal::Stats::add(group, "rxDropped", m_rxDroppedBytes);
+}
+
+void cal::Uart::rxDone(UARTDriver *uartp) {
+  // push byte-read event to the subsystem's event consumer
+  // @TODO Add support for multi-byte messages, receiving whole frames into
+  //       a cal::Payload carried by a single kUartRx event
+  Event e = Event(Event::Type::kUartRx, m_rxBuffer[0]);
+  // if the event queue cannot be immediately acquired, the push fails
+  bool success = m_eventQueue.tryPush(e);
+  m_rxBytes.increment();
+  if (!success) {
+    m_rxDroppedBytes.increment();
+
+    // @TODO implement a callback / condition var notified function
+    // that pushes the event to the queue when it frees up but
+    // doesn't block in this thread when the lock on the consumer's
+    // queue can't immediately be acquired
+
+    // @note currently we drop RX bytes on the floor when the consumer
+    //       isn't ready to receive them (this LED toggles)
+    palTogglePad(STARTUP_LED_PORT, STARTUP_LED_PIN);
   }
+  // start next rx
+  uartStopReceive(uartp);
+  uartStartReceive(uartp, 1, m_rxBuffer);
 }
 
 void cal::Uart::txEmpty(UARTDriver *uartp) {
   // this is called every time the UART interface finishes copying
   // over bytes from a software-level tx buffer (the one passed to
   // the async start send function)
+  static_cast<void>(uartp);
 
-  cal::Uart *_this = cal::Uart::getDriversSubsys(uartp);
-
-  // if the queue is non-empty, acquire, copy up to kMaxMsgLen of its
-  // content to the output buffer and start a new transmission
-  if (_this->m_d3TxQueue.Size() > 0) {
-    // acquire lock guard in current scope
-
-    // @TODO Is this lock really necessary? What's wrong with the size
-    //       changing between the corresponding instructions
-    //std::lock_guard<chibios_rt::Mutex> lock(_this->m_d3TxQueueMut);
+  chSysLockFromISR();
+  // the transmitted run of the ring is free again
+  m_txTail += m_txInFlight;
+  m_txInFlight = 0;
+  completeSendsI();
 
-    // determine num tx bytes to transmit, clamping to kMaxMsgLen
-    uint32_t txCount = _this->m_d3TxQueue.Size() > kMaxMsgLen
-      ? kMaxMsgLen : _this->m_d3TxQueue.Size();
-    // copy over msg contents
-    for (uint32_t i = 0; i < txCount; i++) {
-      _this->m_txBuffer[i] = _this->m_d3TxQueue.PopFront();
-    }
-    // start the tx
-    uartStopSend(uartp);
-    uartStartSend(uartp, txCount, _this->m_txBuffer);
+  // start transmitting whatever was queued meanwhile
+  if (m_txHead != m_txTail) {
+    startTxI();
   } else {
-    // otherwise, clear the interface ready flag
-    _this->m_d3IsReady = true;
+    m_txBusy = false;
+  }
+  chThdDequeueAllI(&m_txWaiters, MSG_OK);
+  cal::Delegate<void()> hook = m_txHook;
+  chSysUnlockFromISR();
+
+  // sends completed and TX space freed up, e.g. for awaiting tasks
+  if (hook) {
+    hook();
   }
 }
@@ -12,11 +12,30 @@
 #include "../../common/Event.h"
 #include "../../common/EventQueue.h"
 #include "../../common/CircularBuffer.h"
+#include "../../common/Delegate.h"
+#include "../../common/DriverCallback.h"
+#include "../../common/FixedString.h"
+#include "../../common/Histogram.h"
+#include "../../common/Printf.h"
+#include "../../common/Stats.h"
 #include "ch.h"
 #include "hal.h"
 
 namespace cal {
 
+/**
+ * @brief What a send to a full TX ring does
+ */
+enum class TxFullPolicy : uint8_t {
+  // drop the whole message, counted in txDropped
+  kDrop,
+  // send what fits, dropping the rest
+  kTruncate,
+  // wait for the driver to free up space, up to a timeout, then drop.
+  // Threads only.
+  kWait
+};
+
 /**
  *
  * UART subsystem, sitting on top of the chibios UART driver. Only one
@@ -79,12 +98,16 @@ class Uart {
    */
   Uart(UartInterface ui, EventQueue& eq);
 
+  // instances are looked up by address from the driver callbacks
+  Uart(const Uart&) = delete;
+  Uart& operator=(const Uart&) = delete;
+
   /**
    * @brief Convert a float to a string
    * @note For now, this just truncates the float
    * @TODO move this out of the UART subsystem and into a common utils
    */
-  static std::string to_string(float num);
+  static cal::FixedString<16> to_string(float num);
 
   /*
    * @brief wrapper for send(char*,uint16) that takes a char
@@ -95,9 +118,16 @@ class Uart {
   void send(int num);
 
   /**
-   * @brief C++ style wrapper for send(char*, uint16_t)
+   * @brief Wrapper for send(char*, uint16_t) taking any run of characters,
+   *        e.g. a cal::FixedString composed without the heap
+   */
+  void send(cal::StringView str);
+
+  /**
+   * @brief Wrapper for send(cal::StringView), for callers that already have a
+   *        std::string
    */
-  void send(std::string str);
+  void send(const std::string& str);
 
   /*
    * @brief wrapper for send(char*,uint16) that takes a c-style null-terminated
@@ -109,82 +139,202 @@ class Uart {
 
   /**
    * @brief Queue a TX UART Frame for async transmission
-   * @note The contents of str is immediately copied to memory
-   *       allocated by the subsystem instance, and can therefore be
-   *       forgotten about after send() exits
+   * @note The contents of str is immediately copied to the TX ring, and can
+   *       therefore be forgotten about after send() exits. Callable from any
+   *       context (unless the TX full policy is kWait).
    * TODO: Make it UART interface-specific with the new multi-instance UART
    *       abstraction model
    */
   void send(const char * str, uint16_t len);
 
   /**
-   * @TODO Make these private and only accessible from within the class
-   *
-   * @note below are callbacks used for each interface (currently just
-   *       one). They are static so that their signatures match those
-   *       required by ChibiOS and are still encapsulated by the class.
-   *       To gain access to interface states, static vars are used in
-   *       the class, that are essentially globals encapsulated in this
-   *       class's namespace. These globals are necessary because the
-   *       callbacks do not provide an arg for arbitrary data (like
-   *       the virtual timer callbacks), which could otherwise have
-   *       been used to pass a reference to a class instance.
+   * @brief Queue len bytes of any length with flow control, waiting for the
+   *        driver to free up TX ring space whenever it's full
+   * @param timeout System ticks to wait each time the ring stays full
+   * @return Bytes queued, less than len if the ring stayed full for the
+   *         timeout (the rest is dropped)
+   * @note Threads only. Ignores kMaxMsgLen and the TX full policy, and bytes
+   *       are copied kMaxMsgLen at a time, so the kernel is never locked
+   *       longer than for a send()
    */
-  // @brief This callback fires when an RX software buffer has been
-  //        completely written
-  static void rxDone(UARTDriver *uartp);
+  size_t write(const char *str, size_t len,
+      systime_t timeout = TIME_INFINITE);
 
-  // @brief This callback fires when a TX software buffer has been
-  //        completely written to hardware interface buffers
-  static void txEmpty(UARTDriver *uartp);
+  /**
+   * @brief Wait until everything queued has been transmitted (i.e. the
+   *        driver read its last byte), threads only
+   * @return False if timed out
+   */
+  bool flush(systime_t timeout = TIME_INFINITE);
+
+  /**
+   * @brief Format (chprintf-style) and queue a message, without blocking on
+   *        the wire
+   * @return Characters formatted, messages are cut at cal::kMaxPrintfLen
+   */
+  int printf(const char *fmt, ...);
+
+  /**
+   * @brief Route std::printf (see StdLib.cpp) to this interface's TX ring
+   */
+  void routePrintf();
+
+  /**
+   * @brief Set what sends to a full TX ring do
+   * @param timeout System ticks a kWait send waits for space
+   */
+  void setTxFullPolicy(cal::TxFullPolicy policy,
+      systime_t timeout = TIME_INFINITE);
+
+  /**
+   * @brief send(), returning a ticket to check the send's completion with
+   * @return Ticket for txDone()
+   */
+  uint32_t sendAsync(const char * str, uint16_t len);
+
+  /**
+   * @brief Check whether a send completed, i.e. the driver read its last
+   *        queued byte. A send dropped from a full TX ring is complete right
+   *        away, a truncated one once its queued bytes are read.
+   * @param ticket Returned by the sendAsync() to check
+   * @note Tickets are TX ring positions (running byte counts), a ticket must
+   *       be checked before 2GB more are sent
+   */
+  bool txDone(uint32_t ticket);
+
+  // @return Bytes that can currently be sent without overflowing the TX
+  //         ring, e.g. for background output that only uses spare bandwidth
+  size_t txFree();
+
+  /**
+   * @brief Record the latency of every send(), from the call until the
+   *        driver has read its last byte (txEmpty), in microseconds
+   * @param latency Histogram to record to, nullptr disables recording
+   * @note Timed with cal::Clock, which must be started
+   */
+  void setTxLatencyHistogram(cal::Histogram *latency);
+
+  /**
+   * @brief Call hook whenever a transmission ends, i.e. sends may have
+   *        completed and txFree() grown (e.g. to wake a cal::TaskScheduler)
+   * @note Called from the driver callback (ISR context)
+   */
+  void setTxHook(cal::Delegate<void()> hook);
 
-  // @brief Return pointer to the instance of self associated with the
-  //        passed driver
-  // @note Since this is a subsystem, it probably shouldn't need or
-  //       have multiple instances, but who knows (currently always
-  //       returns the single subsys instance)
-  static Uart *getDriversSubsys(UARTDriver *uartp);
+  /**
+   * @brief Register bytes sent and received, and bytes dropped either way,
+   *        in cal::Stats
+   * @param group Name the interface's stats are listed under
+   */
+  void registerStats(const char *group);
 
   // Max length of messages in bytes. Anything longer than this many
   // bytes must be broken down into multiple messages
   static constexpr uint32_t kMaxMsgLen = 100;
 
+  // Max number of sends awaiting completion that TX latency is recorded for,
+  // the oldest ones are forgotten
+  static constexpr size_t kMaxTrackedSends = 8;
+
+  // Bytes of the TX ring, a power of two (positions wrap)
+  static constexpr size_t kTxRingSize = 512;
+
  private:
+  /**
+   * @note ChibiOS UART callbacks are static and only get the driver, so the
+   *       driver is started with a cal::DriverConfig holding this instance,
+   *       and the callbacks are cal::DriverCallback trampolines to these
+   */
+  // @brief This callback fires when an RX software buffer has been
+  //        completely written
+  void rxDone(UARTDriver *uartp);
+
+  // @brief This callback fires when a TX software buffer has been
+  //        completely written to hardware interface buffers
+  void txEmpty(UARTDriver *uartp);
+
+  // @brief Account for a send that just queued bytes (kernel locked, in the
+  //        critical section that queued them), tracking it if TX latency is
+  //        being recorded
+  // @param start cal::Clock::now32() at the send's call
+  // @return The send's ticket
+  uint32_t trackSendI(size_t queued, uint32_t start);
+
+  // @brief Wait until len bytes fit the TX ring, or the kWait timeout
+  void waitForTxSpace(uint16_t len);
+
+  // @brief Wait (kernel locked) until a transmission ends
+  // @return False if timed out
+  bool waitForTxEndS(systime_t timeout);
+
+  // @brief Copy what the TX full policy lets in to the ring, starting a
+  //        transmit if the driver is idle (kernel locked)
+  // @return Bytes queued
+  size_t queueTxI(const char *str, uint16_t len);
+
+  // @brief Copy count bytes that are known to fit to the ring, starting a
+  //        transmit if the driver is idle (kernel locked)
+  void copyTxI(const char *str, size_t count);
+
+  // @brief Hand the driver the oldest contiguous run of queued bytes
+  //        (kernel locked)
+  void startTxI();
+
+  // @return Bytes free in the TX ring (kernel locked)
+  size_t txFreeI() const;
+
+  // @brief std::printf sink, see routePrintf()
+  void sendPrintf(const char *str, size_t len);
+
+  // @brief Record the latency of every tracked send the transmission that
+  //        just ended completed (called from txEmpty with the kernel locked)
+  void completeSendsI();
+
+  struct TrackedSend {
+    // m_txHead once the send was queued, i.e. the send is complete once
+    // m_txTail reaches it
+    uint32_t end;
+
+    // cal::Clock::now32() at the send() call
+    uint32_t start;
+  };
+
   // interface-specific members
   UartInterface m_uartInterface;
 
-  // interface-wide members (static members facilitating static chibios
-  // callbacks)
+  // TX ring the driver transmits from directly. Positions are running byte
+  // counts: [m_txTail, m_txTail + m_txInFlight) is being transmitted, up to
+  // m_txHead is queued. Only accessed with the kernel locked.
+  char m_txRing[kTxRingSize] = {};
+  uint32_t m_txHead = 0;
+  uint32_t m_txTail = 0;
+  bool m_txBusy = false;
 
-  /*
-   * @note To navigate the ChibiOS constraint of static UART callbacks
-   *       with a predefined signature (no arbitrary params), and
-   *       since this callbacks are provided a pointer to the
-   *       UARTDriver struct, callbacks will be statically registered
-   *       (and encapsulated) within this class's (hopefully private)
-   *       members, allowing a lookup of the interface instance
-   *       corresponding to the callback that was hit
-   */
-  // contains pointers to all registered UARTDrivers, their index in
-  // this array corresponds to the index of their Uart pointer
-  // in driverToSubsysLookup
-  static std::array<UARTDriver *,4> registeredDrivers;
-
-  // contains pointers to instances of this class, used for lookup of
-  // members from static C-style callbacks
-  static std::array<Uart *,4> driverToSubsysLookup;
-
-  // UARTDriver UARTD3 specific fields (need to generalize)
-  CircularBuffer<char> m_d3TxQueue{kMaxMsgLen*2};
-  chibios_rt::Mutex m_d3TxQueueMut;
-  bool m_d3IsReady = true;
-  char m_txBuffer[Uart::kMaxMsgLen] = {};
+  // what sends to a full ring do, and the threads waiting for a transmission
+  // to end (kWait sends, write() and flush()), all woken whenever one does
+  cal::TxFullPolicy m_txFullPolicy = cal::TxFullPolicy::kDrop;
+  systime_t m_txWaitTimeout = TIME_INFINITE;
+  threads_queue_t m_txWaiters;
+
+  // TX latency tracking, against ring positions
+  cal::Histogram *m_txLatency = nullptr;
+  std::array<TrackedSend, kMaxTrackedSends> m_trackedSends = {};
+  size_t m_trackedHead = 0;
+  size_t m_trackedCount = 0;
+  uint16_t m_txInFlight = 0;
+  cal::Delegate<void()> m_txHook;
+
+  // statistics
+  cal::Counter m_txBytes;
+  cal::Counter m_txDroppedBytes;
+  cal::Counter m_rxBytes;
+  cal::Counter m_rxDroppedBytes;
 
   static constexpr uint8_t kUartOkMask = EVENT_MASK(1);
   static constexpr uint8_t kUartChMask = EVENT_MASK(4);
   uint16_t m_rxBuffer[11];
   UARTDriver *m_uartp;
-  UARTConfig m_uartConfig;
+  cal::DriverConfig<UARTConfig, Uart> m_uartConfig{this};
   chibios_rt::Mutex m_uartMut;
   EventQueue& m_eventQueue;
 };
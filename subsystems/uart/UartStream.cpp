@@ -0,0 +1,58 @@
+#include "../../cal.h"
+#include "UartStream.h"
+
+#include <type_traits>
+
+#include "Uart.h"
+#include "ch.h"
+#include "hal.h"
+
+/**
+ * @note The VMT is filled in by name, the HAL version decides which other
+ *       members (e.g. instance_offset) it has, and they're zero
+ */
+cal::UartStream::UartStream(cal::Uart& uart) : m_vmt(), m_uart(&uart) {
+  m_vmt.write = &UartStream::write;
+  m_vmt.read = &UartStream::read;
+  m_vmt.put = &UartStream::put;
+  m_vmt.get = &UartStream::get;
+  m_stream.vmt = &m_vmt;
+}
+
+BaseSequentialStream *cal::UartStream::stream() { return &m_stream; }
+
+size_t cal::UartStream::write(void *instance, const uint8_t *bp, size_t n) {
+  UartStream& self = from(instance);
+  // sends are 16 bit
+  size_t written = 0;
+  while (written < n) {
+    size_t count = n - written < 0xFFFF ? n - written : 0xFFFF;
+    self.m_uart->send(reinterpret_cast<const char *>(bp + written),
+        static_cast<uint16_t>(count));
+    written += count;
+  }
+  return n;
+}
+
+size_t cal::UartStream::read(void *instance, uint8_t *bp, size_t n) {
+  static_cast<void>(instance);
+  static_cast<void>(bp);
+  static_cast<void>(n);
+  return 0;
+}
+
+msg_t cal::UartStream::put(void *instance, uint8_t b) {
+  from(instance).m_uart->send(static_cast<char>(b));
+  return MSG_OK;
+}
+
+msg_t cal::UartStream::get(void *instance) {
+  static_cast<void>(instance);
+  return MSG_RESET;
+}
+
+cal::UartStream& cal::UartStream::from(void *instance) {
+  static_assert(std::is_standard_layout<UartStream>::value,
+      "the stream must be at the start of the adapter");
+  return *reinterpret_cast<UartStream *>(instance);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// @TODO finish the chibios-subsys common header that includes all (cal.hpp)
+#include "../../cal.h"
+#include "Uart.h"
+#include "ch.h"
+#include "hal.h"
+
+namespace cal {
+
+/**
+ * @brief ChibiOS BaseSequentialStream over a cal::Uart's TX ring, for code
+ *        written against streams (e.g. chprintf, shells)
+ *
+ * Writes are queued like any send, so they never block on the wire (unless
+ * the interface's TX full policy is kWait). Reads return nothing, received
+ * bytes go to the interface's event queue.
+ *
+ * @code
+ *   static cal::UartStream console(uart);
+ *   chprintf(console.stream(), "heap free [%u]\r\n", free);
+ * @endcode
+ *
+ * @note chprintf puts a character at a time, each a send of its own, so
+ *       cal::Uart::printf() is cheaper where a stream isn't required
+ */
+class UartStream {
+ public:
+  explicit UartStream(cal::Uart& uart);
+
+  // the stream's VMT finds the instance by address
+  UartStream(const UartStream&) = delete;
+  UartStream& operator=(const UartStream&) = delete;
+
+  BaseSequentialStream *stream();
+
+ private:
+  static size_t write(void *instance, const uint8_t *bp, size_t n);
+  static size_t read(void *instance, uint8_t *bp, size_t n);
+  static msg_t put(void *instance, uint8_t b);
+  static msg_t get(void *instance);
+
+  // @return The adapter the stream's methods were called on
+  static UartStream& from(void *instance);
+
+  // first, the VMT methods get its address
+  BaseSequentialStream m_stream;
+  BaseSequentialStreamVMT m_vmt;
+  cal::Uart *m_uart;
+};
+
+}
@@ -46,10 +46,10 @@ int main() {
   // Init LED states to LOW
   palClearPad(STARTUP_LED_PORT, STARTUP_LED_PIN);
 
-  EventQueue fsmEventQueue = EventQueue();
+  cal::CriticalSectionEventQueue fsmEventQueue;
 
   // setup a UART interface to immediately begin transmitting and receiving
-  cal::Uart uart = cal::Uart(UartInterface::kD3, fsmEventQueue);
+  cal::Uart uart(UartInterface::kD3, fsmEventQueue);
 
   // test async UART transmit
   // @TODO move these to UART loop-back mode tests with uTest framwork
@@ -59,8 +59,9 @@ int main() {
 
   // try sending a float
   constexpr float my_float = 314.5594;
-  uart.send("Float value is: " + cal::Uart::to_string(my_float)
-      + "\n\n");
+  cal::FixedString<32> floatMsg;
+  floatMsg << "Float value is: " << cal::Uart::to_string(my_float) << "\n\n";
+  uart.send(floatMsg);
 
   // Indicate startup - blink then stay on
   for (uint8_t i = 0; i < 5; i++) {
@@ -76,6 +77,7 @@ int main() {
   /**
    * New uTest Framework code
    */
+  uartUnderTest = &uart;
   UartWriter writer(&uart);
 
   utest::TestWriterReference writers[]{
@@ -93,13 +95,14 @@ int main() {
   } else {
     uart.send("\r\nTests FAILED\r\n");
   }
+  writer.flush();
 
   // transmit back any bytes received over UART
   while (1) {
     // always deplete the queue to help ensure that events are
     // processed faster than they're generated
-    while (fsmEventQueue.size() > 0) {
-      Event e = fsmEventQueue.pop();
+    Event e;
+    while (fsmEventQueue.tryPop(e)) {
 
       if (e.type() == Event::Type::kUartRx) {
         // send received byte back to source (test throughput)
@@ -10,14 +10,16 @@
 
 UartWriter::UartWriter(cal::Uart* uart) : m_uart(uart) {}
 
+/**
+ * @note Output of any length streams through the UART's TX ring, waiting for
+ *       space when the reporter outpaces the wire, so nothing is dropped or cut
+ */
 void UartWriter::write(const utest::TestString& str) noexcept {
-  // send the test log over UART
-  m_uart->send(str.data());
-  // @TODO Optimize the Uart subsystem so that it can keep up with continusouly
-  //       spammed prints and has a fall-back for and/or indication of when it
-  //       can't. Actually just optimize and warn the user. There's no way to
-  //       continusouly drive an interface with more than it can handle
-  chThdSleepMilliseconds(1);
+  m_uart->write(str.data(), str.size());
+}
+
+void UartWriter::flush() noexcept {
+  m_uart->flush();
 }
 
 void UartWriter::color(utest::TestColor c) {
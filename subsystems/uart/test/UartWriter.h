@@ -11,6 +11,12 @@ class UartWriter final : public utest::TestWriter {
   public:
     UartWriter(cal::Uart* uart) noexcept;
 
+    /**
+     * @brief Wait until everything written has been transmitted, e.g. at the
+     *        end of a test run, before anything timing-sensitive
+     */
+    void flush() noexcept;
+
   private:
     virtual void write(const utest::TestString& str) noexcept override;
 
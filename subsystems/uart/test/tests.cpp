@@ -9,6 +9,14 @@ static std::string MyStr() {
   return std::string("Some String");
 }
 
+// interface under test, set by main() before the tests run
+static cal::Uart *uartUnderTest = nullptr;
+
+// a send that fits the TX ring, under kMaxMsgLen
+static const char kFiller[] =
+    "0123456789012345678901234567890123456789"
+    "0123456789012345678901234567890123456789\n";
+
 /**
  * @TODO fix the assertion error reporting in the lib -- utest breaks when an
  *       assertion fails and it tries to describe expected vs. received. The
@@ -36,6 +44,30 @@ static utest::TestRunner g([] (utest::TestSuite& test_suite) {
     });
   });
 
+  test_suite.name("Uart TX").run([] (utest::TestCase& test_case) {
+    test_case.name("dropped_send_leaves_earlier_ticket").run(
+        [] (utest::TestParams& p) {
+      cal::Uart& uart = *uartUnderTest;
+      const uint16_t len = sizeof(kFiller) - 1;
+      uart.flush();
+
+      // fill the ring behind an earlier send, faster than the wire drains it
+      uint32_t earlier = uart.sendAsync(kFiller, len);
+      while (uart.txFree() >= len) {
+        uart.sendAsync(kFiller, len);
+      }
+
+      // the default kDrop policy drops the newest send, which is complete,
+      // but mustn't complete the earlier send still in the ring
+      uint32_t dropped = uart.sendAsync(kFiller, len);
+      utest::TestAssert{p}.equal(uart.txDone(dropped), true);
+      utest::TestAssert{p}.equal(uart.txDone(earlier), false);
+
+      uart.flush();
+      utest::TestAssert{p}.equal(uart.txDone(earlier), true);
+    });
+  });
+
   test_suite.name("Simple Suite 2").run([] (utest::TestCase& test_case) {
     test_case.name("trivial_case_0").run([] (utest::TestParams& p) {
       utest::TestAssert{p}.equal(Trivial(1), 2u);